@@ -25,6 +25,18 @@ struct ProgramArguments {
   bool sweeping = false;
   // the ID of the DIMM that is currently inserted
   long dimm_id = -1;
+  // number of superpages (each of MEM_SIZE bytes) to allocate and hammer on
+  size_t num_superpages = 1;
+  // whether to ignore the DRAM calibration cache and redo the calibration
+  bool recalibrate = false;
+  // number of threads used to initialize the memory area (0 = one per CPU of the local NUMA node)
+  size_t num_init_threads = 0;
+  // number of mappings of a pattern that are hammered at once, each on a different bank
+  size_t num_interleaved_banks = 1;
+  // number of threads hammering different patterns at the same time (0 = determined by a calibration)
+  size_t num_hammer_threads = 1;
+  // whether to run the micro-benchmarks (e.g., of the memory check) after initializing the memory
+  bool run_benchmarks = false;
   // these two parameters define the default program mode: do fuzzing and synchronize with REFRESH
   bool do_fuzzing = true;
   bool use_synchronization = true;
@@ -35,6 +47,11 @@ extern ProgramArguments program_args;
 
 int main(int argc, char **argv);
 
+std::string get_cpu_model();
+
+/// Returns the key of the DRAM calibration cache entry for the current machine, DIMM, and memory configuration.
+std::string get_calibration_key();
+
 void handle_args(int argc, char **argv);
 
 [[ noreturn ]] void handle_arg_generate_patterns(int num_activations, size_t probes_per_pattern);
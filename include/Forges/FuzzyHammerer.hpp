@@ -10,6 +10,8 @@
 #include "Memory/Memory.hpp"
 #include "ReplayingHammerer.hpp"
 
+struct PatternJob;
+
 class FuzzyHammerer {
  public:
   // counter for the number of generated patterns so far
@@ -35,8 +37,12 @@ class FuzzyHammerer {
 
   static void test_location_dependence(ReplayingHammerer &rh, HammeringPattern &pattern);
 
-  static void probe_mapping_and_scan(PatternAddressMapper &mapper, Memory &memory,
-                                     FuzzingParameterSet &fuzzing_params, size_t num_dram_locations);
+  /// Hammers the mappings [first_mapping, first_mapping+num_mappings) of the job, which are all hammered by the given
+  /// (already jitted) function, at several DRAM locations and returns the number of flipped bits of each mapping. This
+  /// is thread-safe as long as the mappings of concurrent calls are on different banks.
+  static std::vector<size_t> probe_mappings_and_scan(PatternJob &job, size_t first_mapping, size_t num_mappings,
+                                                     CodeJitter &code_jitter, Memory &memory,
+                                                     FuzzingParameterSet &fuzzing_params, size_t pattern_no);
 
   static void log_overall_statistics(size_t cur_round, const std::string &best_mapping_id,
                                      size_t best_mapping_num_bitflips, size_t num_effective_patterns);
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_FORGES_HAMMERWORKERPOOL_HPP_
+#define BLACKSMITH_INCLUDE_FORGES_HAMMERWORKERPOOL_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Memory/Memory.hpp"
+
+/// A set of hammering threads, each pinned to its own CPU of the local NUMA node. The coordinator (i.e., the fuzzer)
+/// submits tasks together with the banks they hammer; the pool never runs two tasks that share a bank at the same time
+/// such that the tasks do not disturb each other's activation pattern. The log messages of a task are captured and
+/// handed back to the coordinator, which is the only thread writing into the logfile.
+class HammerWorkerPool {
+ public:
+  using Task = std::function<void()>;
+
+ private:
+  struct PendingTask {
+    Task task;
+
+    /// a bitmask of the banks hammered by the task
+    uint64_t banks;
+  };
+
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+
+  /// signals the workers that a task was submitted or that a bank became free
+  std::condition_variable task_available;
+
+  /// signals the coordinator that a task finished
+  std::condition_variable task_finished;
+
+  std::deque<PendingTask> pending_tasks;
+
+  /// a bitmask of the banks hammered by the running tasks
+  uint64_t busy_banks;
+
+  size_t num_running;
+
+  bool stopping;
+
+  /// the log messages of the finished tasks that were not taken by the coordinator yet
+  std::vector<std::string> finished_logs;
+
+  void run();
+
+  /// Measures the number of ACTs per refresh interval that each of num_threads threads achieves when hammering a
+  /// different bank at the same time.
+  static double measure_acts_per_trefi(const std::vector<int> &cpus, size_t num_threads);
+
+  /// Returns the two rows that each calibration thread alternates between in its own bank. They are half a superpage
+  /// apart such that no row in between them is hammered double-sided.
+  static std::pair<size_t, size_t> get_calibration_rows();
+
+ public:
+  /// the time each thread hammers during one calibration step
+  static constexpr size_t CALIBRATION_DURATION_MS = 250;
+
+  /// the number of rows on each side of a calibration row that are checked for bit flips after the calibration
+  static constexpr size_t CALIBRATION_CHECK_ROWS = 5;
+
+  /// Starts one worker thread for each of the given CPUs.
+  explicit HammerWorkerPool(const std::vector<int> &cpus);
+
+  /// Waits for the submitted tasks to finish and stops the worker threads.
+  ~HammerWorkerPool();
+
+  HammerWorkerPool(const HammerWorkerPool &) = delete;
+
+  HammerWorkerPool &operator=(const HammerWorkerPool &) = delete;
+
+  /// Queues a task that hammers the given banks.
+  void submit(Task task, const std::vector<int> &banks);
+
+  /// Blocks until fewer tasks are queued or running than there are workers, i.e., until submitting another task
+  /// keeps all workers busy.
+  void wait_for_idle_worker();
+
+  /// Blocks until all submitted tasks finished.
+  void wait_all();
+
+  /// Returns the log messages of the tasks that finished since the last call.
+  std::vector<std::string> take_logs();
+
+  [[nodiscard]] size_t get_num_workers() const;
+
+  /// Returns the CPUs of the local NUMA node that are not used by the calling thread, the pattern jitting thread, and
+  /// the ACTs per tREFI estimator.
+  static std::vector<int> get_worker_cpus();
+
+  /// Measures how the ACT rate per thread drops as more threads hammer at the same time and returns the number of
+  /// threads (at most max_workers) that maximizes the number of probes per hour, i.e., the number of threads times
+  /// the ACT rate per thread. As the calibration hammers the calibration rows single-sided, it afterwards checks the
+  /// rows around them and repairs any bit flips such that these are not attributed to a later pattern.
+  static size_t calibrate_num_workers(const std::vector<int> &cpus, size_t max_workers, Memory &memory);
+};
+
+#endif //BLACKSMITH_INCLUDE_FORGES_HAMMERWORKERPOOL_HPP_
@@ -47,6 +47,14 @@ class ReplayingHammerer {
   // to trigger bit flips
   int hammering_num_reps = initial_hammering_num_reps;
 
+  // the number of times the relocatable function had to be jitted again during the last sweep because the shifted
+  // aggressors could not be expressed by its address table (e.g., two aggressors mapped to the same row)
+  size_t num_relocatable_rejits = 0;
+
+  // the number of rows at the beginning of a sweep for which the pattern is jitted for each row (as it was done before
+  // the relocatable code was introduced) to compare the sweep rates of both approaches
+  const size_t num_sweep_rows_jitted_per_row = 8;
+
   size_t hammer_pattern(FuzzingParameterSet &fuzz_params, CodeJitter &code_jitter, HammeringPattern &pattern,
                         PatternAddressMapper &mapper, FLUSHING_STRATEGY flushing_strategy,
                         FENCING_STRATEGY fencing_strategy, unsigned long num_reps, int aggressors_for_sync,
@@ -6,11 +6,14 @@
 #ifndef CODEJITTER
 #define CODEJITTER
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include "Utilities/Enums.hpp"
 #include "Fuzzer/FuzzingParameterSet.hpp"
+#include "Fuzzer/HammerInterpreter.hpp"
+#include "Fuzzer/TimingTrace.hpp"
 
 #ifdef ENABLE_JITTING
 #include <asmjit/asmjit.h>
@@ -20,55 +23,201 @@
 #include <nlohmann/json.hpp>
 #endif
 
+/// A handle to a jitted hammering function. The code itself lives in the process-wide JitCodeArena, hence creating and
+/// copying instances is cheap; copies take over the jitting parameters but not the jitted function. Alternatively, the
+/// accesses can be executed by a HammerInterpreter (see use_interpreter).
 class CodeJitter {
  private:
-#ifdef ENABLE_JITTING
-  /// runtime for JIT code execution, can be reused by cleaning the function ptr (see cleanup method)
-  asmjit::JitRuntime runtime;
+  /// a function pointer to a function that takes no input (void) and returns an integer
+  int (*fn)() = nullptr;
+
+  /// a function pointer to a relocatable function that takes the address table as input and returns an integer
+  int (*fn_relocatable)(volatile char *const *address_table) = nullptr;
+
+  /// the distinct addresses accessed by the relocatable function, the function loads each address from its slot
+  std::vector<volatile char *> address_table;
+
+  /// the slot in address_table of each access of the sequence that the relocatable function was jitted for
+  std::vector<size_t> access_slots;
+
+  /// executes the accesses instead of a jitted function if use_interpreter is set
+  HammerInterpreter interpreter;
+
+  /// the buffer into which the hammering code writes a record at each synchronization if use_timing_trace was set when
+  /// jitting; it is allocated once as its address is embedded into the jitted code
+  std::unique_ptr<TimingTrace> trace;
+
+  /// the slot in address_table of each address, only used while jitting a relocatable function
+  std::unordered_map<uint64_t, size_t> slot_of_address;
+
+  /// the number of accesses in the loop body and the number of loop iterations of the last jitted function, both are
+  /// zero if the pattern was fully unrolled
+  int loop_body_accesses;
+
+  int loop_iterations;
 
-  /// a logger that keeps track of the generated ASM instructions - useful for debugging
-  asmjit::StringLogger *logger = nullptr;
+  /// the size in bytes of the last jitted function
+  size_t code_size;
+
+  /// the number of ACTs per refresh interval achieved during the last call of hammer_pattern (incl. synchronization)
+  double last_acts_per_trefi;
+
+  /// the number of distinct aggressors whose address was kept in a register by the last jitted function, zero if the
+  /// addresses were loaded before each access
+  size_t num_register_aggressors;
+
+  /// the number of access sequences that the last jitted function interleaves, one if it was jitted by jit_strict or
+  /// jit_relocatable
+  size_t num_interleaved_sequences;
+
+#ifdef ENABLE_JITTING
+  /// the register holding each address, only used while jitting a function whose aggressors are register-resident
+  std::unordered_map<uint64_t, asmjit::x86::Gp> register_of_address;
 #endif
 
-  /// a function pointer to a function that takes no input (void) and returns an integer
-  int (*fn)() = nullptr;
+  void jit_internal(int num_acts_per_trefi,
+                    FLUSHING_STRATEGY flushing,
+                    FENCING_STRATEGY fencing,
+                    const std::vector<volatile char *> &aggressor_pairs,
+                    bool sync_each_ref,
+                    int num_aggressors_for_sync,
+                    int total_num_activations,
+                    int base_period,
+                    bool relocatable);
+
+#ifdef ENABLE_JITTING
+  /// emits the instructions to load the given address into the register: as immediate if the function is not
+  /// relocatable, otherwise from the address table whose base address is passed in rdi
+  void emit_load_address(asmjit::x86::Assembler &assembler, const asmjit::x86::Gp &reg, volatile char *addr);
+
+  /// returns the memory operand to access the given address: the register holding the address if it is
+  /// register-resident, otherwise rax after emitting the instructions to load the address into it
+  asmjit::x86::Mem emit_address_operand(asmjit::x86::Assembler &assembler, volatile char *addr);
+
+  /// emits the instruction that activates the given aggressor's row according to access_strategy
+  void emit_access(asmjit::x86::Assembler &assembler, volatile char *addr);
+
+  /// emits the given flush instruction for the given address
+  void emit_flush(asmjit::x86::Assembler &assembler, volatile char *addr, FLUSH_INSTRUCTION instruction);
+
+  void sync_ref(const std::vector<volatile char *> &aggressor_pairs, asmjit::x86::Assembler &assembler);
+
+  /// returns the key of the function for the given accesses and parameters in the JitCodeCache
+  uint64_t get_code_cache_key(int num_acts_per_trefi, const std::vector<volatile char *> &aggressor_pairs,
+                              bool sync_each_ref, int base_period) const;
+
+  /// emits the instructions to write the current timestamp into the current TimingTraceRecord, either as the beginning
+  /// or as the end of the synchronization; the latter also writes the activation counters and advances the ring buffer
+  void emit_trace_record(asmjit::x86::Assembler &assembler, bool sync_end);
+#endif
 
  public:
+  /// whether the accesses are executed by the HammerInterpreter instead of generating code, applies to all instances;
+  /// this is always the case if the program was built without ENABLE_JITTING
+  static bool use_interpreter;
+
+  /// whether the hammering code records the timing of each synchronization with REFRESH (see TimingTrace), applies to
+  /// all instances
+  static bool use_timing_trace;
+
+  /// the summary of the timing trace recorded during the last call of hammer_pattern, empty if tracing is disabled
+  TimingTraceStats trace_stats;
+
+  /// Identifies the code generator of this build such that cached code is never executed by another build. It changes
+  /// whenever the code generator is recompiled.
+  static uint64_t get_code_generator_id();
+
+  /// whether jit_strict emits repeating parts of the pattern as loop instead of unrolling all accesses
+  bool use_loop_compression;
+
+  /// whether the jitted function keeps the aggressors' addresses in registers if there are few enough distinct ones
+  bool use_register_aggressors;
+
   bool pattern_sync_each_ref;
 
   FLUSHING_STRATEGY flushing_strategy;
 
   FENCING_STRATEGY fencing_strategy;
 
+  /// the instruction used to access the aggressors while hammering, must be set before jitting; the accesses for
+  /// synchronizing with REFRESH are always plain loads
+  ACCESS_STRATEGY access_strategy;
+
+  /// the instruction used to flush the aggressors while hammering, must be set before jitting; synchronizing with
+  /// REFRESH always uses the preferred evicting flush instruction of the CPU
+  FLUSH_INSTRUCTION flush_instruction;
+
   int total_activations;
 
   int num_aggs_for_sync;
 
   /// constructor
   CodeJitter();
-  
+
+  /// copy constructor, copies the jitting parameters only
+  CodeJitter(const CodeJitter &other);
+
+  /// copy assignment operator, releases the jitted function and copies the jitting parameters only
+  CodeJitter &operator=(const CodeJitter &other);
+
   /// destructor
   ~CodeJitter();
 
-  /// generates the jitted function and assigns the function pointer fn to it
+  /// generates the jitted function and assigns the function pointer fn to it; if base_period is non-zero, periodic
+  /// parts of the access sequence are emitted as loops (see use_loop_compression)
   void jit_strict(int num_acts_per_trefi,
                   FLUSHING_STRATEGY flushing,
                   FENCING_STRATEGY fencing,
                   const std::vector<volatile char *> &aggressor_pairs,
                   bool sync_each_ref,
                   int num_aggressors_for_sync,
-                  int total_num_activations);
+                  int total_num_activations,
+                  int base_period);
+
+  /// same as jit_strict but the generated function loads the addresses from a table instead of embedding them, such
+  /// that the function can be reused for other addresses (e.g., shifted rows while sweeping) via update_addresses
+  void jit_relocatable(int num_acts_per_trefi,
+                       FLUSHING_STRATEGY flushing,
+                       FENCING_STRATEGY fencing,
+                       const std::vector<volatile char *> &aggressor_pairs,
+                       bool sync_each_ref,
+                       int num_aggressors_for_sync,
+                       int total_num_activations,
+                       int base_period);
+
+  /// Generates a function that hammers all given access sequences at once: the i-th accesses of all sequences are
+  /// issued back-to-back such that the memory controller can serve them in parallel if the sequences target different
+  /// banks. The parameters apply to each sequence, i.e., each sequence is hammered with num_acts_per_trefi ACTs per
+  /// refresh interval and total_num_activations ACTs in total.
+  void jit_interleaved(int num_acts_per_trefi,
+                       FLUSHING_STRATEGY flushing,
+                       FENCING_STRATEGY fencing,
+                       const std::vector<std::vector<volatile char *>> &aggressor_sequences,
+                       bool sync_each_ref,
+                       int num_aggressors_for_sync,
+                       int total_num_activations,
+                       int base_period);
+
+  /// Rewrites the address table of the relocatable function such that it accesses the given sequence of addresses.
+  /// Returns false if the sequence cannot be expressed by the function, i.e., if its length differs or it does not
+  /// access the same address at the same positions as the sequence the function was jitted for.
+  bool update_addresses(const std::vector<volatile char *> &aggressor_pairs);
+
+  /// whether this instance holds a jitted relocatable function
+  [[nodiscard]] bool is_relocatable() const;
+
+  [[nodiscard]] size_t get_code_size() const;
+
+  [[nodiscard]] double get_last_acts_per_trefi() const;
+
+  [[nodiscard]] size_t get_num_interleaved_sequences() const;
 
   /// does the hammering if the function was previously created successfully, otherwise does nothing
   int hammer_pattern(FuzzingParameterSet &fuzzing_parameters, bool verbose);
 
-  /// cleans this instance associated function pointer that points to the function that was jitted at runtime;
-  /// cleaning up is required to release memory before jit_strict can be called again
+  /// returns the memory of the function that was jitted at runtime to the JitCodeArena; cleaning up is required before
+  /// jit_strict can be called again
   void cleanup();
-
-#ifdef ENABLE_JITTING
-  static void sync_ref(const std::vector<volatile char *> &aggressor_pairs, asmjit::x86::Assembler &assembler);
-#endif
 };
 
 #ifdef ENABLE_JSON
@@ -9,6 +9,7 @@
 #include <random>
 #include <unordered_map>
 
+#include "Memory/ActsPerTrefiEstimator.hpp"
 #include "Utilities/Range.hpp"
 #include "Utilities/Enums.hpp"
 
@@ -68,6 +69,12 @@ class FuzzingParameterSet {
 
   FENCING_STRATEGY fencing_strategy;
 
+  /// the instruction used to activate the aggressors' rows, randomized among the ones supported by the CPU
+  ACCESS_STRATEGY access_strategy;
+
+  /// the instruction used to flush the aggressors while hammering, randomized among the ones supported by the CPU
+  FLUSH_INSTRUCTION flush_instruction;
+
   [[nodiscard]] int get_hammering_total_num_activations() const;
 
   [[nodiscard]] int get_num_aggressors() const;
@@ -127,6 +134,10 @@ class FuzzingParameterSet {
   static void print_dynamic_parameters2(bool sync_at_each_ref, int wait_until_hammering_us, int num_aggs_for_sync);
 
   void set_num_activations_per_t_refi(int num_activations_per_t_refi);
+
+  /// Takes over the estimator's current number of ACTs per refresh interval without waiting for a measurement, but
+  /// only if the estimator is sufficiently confident. Returns whether the value was taken over.
+  bool set_num_activations_per_t_refi(const ActsPerTrefiEstimator &estimator);
 };
 
 #endif //BLACKSMITH_INCLUDE_FUZZER_FUZZINGPARAMETERSET_HPP_
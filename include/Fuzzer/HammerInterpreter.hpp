@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_FUZZER_HAMMERINTERPRETER_HPP_
+#define BLACKSMITH_INCLUDE_FUZZER_HAMMERINTERPRETER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Fuzzer/TimingTrace.hpp"
+#include "Utilities/Enums.hpp"
+
+/// Executes the same accesses, flushes, fences, and REFRESH synchronization as the function that CodeJitter generates
+/// for an access sequence, but without generating code. This allows hammering on hosts where runtime code generation
+/// is not available or forbidden. The hammering loop is a separate template instance for each (flushing, fencing)
+/// strategy such that it does not contain any checks for the strategies.
+class HammerInterpreter {
+ private:
+  /// the access sequence, including the accesses used for synchronization at the beginning and the end
+  std::vector<volatile char *> accesses;
+
+  /// a bitmask of ACCESSED_BEFORE, SYNC_AFTER, ROUND_BEGIN, and FLUSH_IN_ROUND for each access
+  std::vector<uint8_t> flags;
+
+  FLUSHING_STRATEGY flushing;
+
+  FENCING_STRATEGY fencing;
+
+  ACCESS_STRATEGY access_strategy;
+
+  FLUSH_INSTRUCTION flush_instruction;
+
+  size_t num_timed_accesses;
+
+  /// the number of accesses of an interleave round, 1 if the sequence is not interleaved
+  size_t round_length;
+
+  int total_num_activations;
+
+  /// if set, a record is written into the trace at each synchronization
+  TimingTrace *trace;
+
+  template<FLUSHING_STRATEGY flushing_strategy, FENCING_STRATEGY fencing_strategy>
+  int hammer_internal() const;
+
+  /// waits for the next REFRESH by repeatedly flushing and accessing the given addresses, returns the number of
+  /// accesses done while waiting
+  static int sync_ref(volatile char *const *aggs, size_t num_aggs);
+
+  /// accesses the address using the given access strategy
+  static void access(volatile char *addr, ACCESS_STRATEGY strategy);
+
+  /// flushes the address using the given flush instruction
+  static void flush(volatile char *addr, FLUSH_INSTRUCTION instruction);
+
+ public:
+  /// the address of the access was accessed before in the sequence, i.e., we need to flush/fence it before the access
+  /// if the flushing/fencing strategy is LATEST_POSSIBLE
+  static constexpr uint8_t ACCESSED_BEFORE = 1;
+
+  /// we need to synchronize with the next REFRESH after the access
+  static constexpr uint8_t SYNC_AFTER = 2;
+
+  /// the access begins a round of an interleaved sequence that accesses an address accessed before, i.e., we need to
+  /// flush the round's FLUSH_IN_ROUND addresses and fence once before the round if the strategy is LATEST_POSSIBLE
+  static constexpr uint8_t ROUND_BEGIN = 4;
+
+  /// the address of the access was accessed before and is flushed at the beginning of its interleave round
+  static constexpr uint8_t FLUSH_IN_ROUND = 8;
+
+  HammerInterpreter();
+
+  /// precomputes the flushes, fences, and synchronization points for the given sequence, takes the same parameters as
+  /// CodeJitter::jit_strict plus the access and flush instructions configured in the CodeJitter and the number of
+  /// sequences interleaved round-robin in the given sequence (see CodeJitter::jit_interleaved)
+  void prepare(int num_acts_per_trefi,
+               FLUSHING_STRATEGY flushing_strategy,
+               FENCING_STRATEGY fencing_strategy,
+               ACCESS_STRATEGY access,
+               FLUSH_INSTRUCTION flush,
+               const std::vector<volatile char *> &aggressor_pairs,
+               bool sync_at_each_ref,
+               int num_aggressors_for_sync,
+               int total_activations,
+               size_t num_interleaved_sequences = 1);
+
+  /// replaces the addresses of the sequence; the caller must ensure that the new sequence accesses the same address at
+  /// the same positions as the prepared one as the flushes and fences are not recomputed
+  void set_addresses(const std::vector<volatile char *> &aggressor_pairs);
+
+  /// writes the timing of each synchronization into the given trace, or nowhere if it is nullptr
+  void set_trace(TimingTrace *timing_trace);
+
+  [[nodiscard]] bool is_prepared() const;
+
+  /// hammers the prepared sequence and returns the number of accesses done for synchronization at the end of each
+  /// pattern round (like the jitted function)
+  int hammer() const;
+
+  void clear();
+};
+
+#endif //BLACKSMITH_INCLUDE_FUZZER_HAMMERINTERPRETER_HPP_
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_FUZZER_JITCODEARENA_HPP_
+#define BLACKSMITH_INCLUDE_FUZZER_JITCODEARENA_HPP_
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+/// A process-wide region of executable memory that hands out and recycles the memory for all jitted functions. The
+/// region is backed by huge pages if possible such that the jitted code of all CodeJitter instances shares few iTLB
+/// entries. Allocating and releasing is thread-safe.
+class JitCodeArena {
+ private:
+  JitCodeArena();
+
+  ~JitCodeArena();
+
+  char *base;
+
+  size_t size;
+
+  /// whether the region is backed by (explicitly allocated) huge pages
+  bool huge_pages;
+
+  std::mutex mutex;
+
+  /// the unused parts of the region, given as offset -> size
+  std::map<size_t, size_t> free_chunks;
+
+  /// the size of each handed out chunk
+  std::unordered_map<void *, size_t> allocated_chunks;
+
+  size_t used_bytes;
+
+ public:
+  /// the size of the region; the jitted functions are a few KB to a few MB each
+  static constexpr size_t ARENA_SIZE = 64UL*1024UL*1024UL;
+
+  /// the alignment of each function, i.e., functions never share a cache line
+  static constexpr size_t ALIGNMENT = 64;
+
+  JitCodeArena(const JitCodeArena &) = delete;
+
+  JitCodeArena &operator=(const JitCodeArena &) = delete;
+
+  /// Returns the arena, the region is mapped on the first call.
+  static JitCodeArena &instance();
+
+  /// Returns a chunk of executable (and writable) memory of at least num_bytes bytes, or nullptr if the arena is full.
+  void *allocate(size_t num_bytes);
+
+  /// Returns the chunk at ptr, which must have been obtained by allocate, to the arena.
+  void release(void *ptr);
+
+  [[nodiscard]] size_t get_used_bytes();
+
+  [[nodiscard]] bool uses_huge_pages() const;
+};
+
+#endif //BLACKSMITH_INCLUDE_FUZZER_JITCODEARENA_HPP_
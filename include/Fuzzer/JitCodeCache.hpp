@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_FUZZER_JITCODECACHE_HPP_
+#define BLACKSMITH_INCLUDE_FUZZER_JITCODECACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// A process-wide on-disk cache of jitted hammering functions. A function jitted by CodeJitter::jit_strict embeds the
+/// aggressors' addresses, which only depend on the (pattern, mapping) pair as the memory area is always mapped at the
+/// same address. Each function is stored in its own file named after a hash of the accesses and the jitting parameters,
+/// such that replaying a pattern again can copy the code into the JitCodeArena instead of generating it. Entries that
+/// were jitted for a memory area at another base address are never used.
+class JitCodeCache {
+ public:
+  /// a cached function together with the stats that CodeJitter reports about it
+  struct Entry {
+    std::vector<uint8_t> code;
+
+    int loop_body_accesses = 0;
+
+    int loop_iterations = 0;
+
+    size_t num_register_aggressors = 0;
+  };
+
+ private:
+  JitCodeCache() = default;
+
+  /// the header of each cache file, followed by the code
+  struct FileHeader {
+    uint64_t magic;
+    uint64_t generator_id;
+    uint64_t key;
+    uint64_t base_address;
+    uint64_t num_accesses;
+    uint64_t code_size;
+    int64_t loop_body_accesses;
+    int64_t loop_iterations;
+    uint64_t num_register_aggressors;
+  };
+
+  /// identifies a cache file and the version of its format
+  static constexpr uint64_t MAGIC = 0x32304354494a5342;  // "BSJITC02"
+
+  std::string directory;
+
+  /// the start of the memory area that the cached functions access
+  uint64_t base_address = 0;
+
+  /// the code generator of this build (see CodeJitter::get_code_generator_id)
+  uint64_t generator_id = 0;
+
+  std::mutex mutex;
+
+  size_t num_hits = 0;
+
+  size_t num_misses = 0;
+
+  /// the number of entries that were ignored because they were created by another build of the code generator
+  size_t num_stale = 0;
+
+  [[nodiscard]] std::string get_filename(uint64_t key) const;
+
+ public:
+  JitCodeCache(const JitCodeCache &) = delete;
+
+  JitCodeCache &operator=(const JitCodeCache &) = delete;
+
+  static JitCodeCache &instance();
+
+  /// Enables the cache, which stores its files in the given directory, for functions accessing the memory area starting
+  /// at base_address and generated by the given code generator. Must be called before any thread jits code.
+  void open(const std::string &cache_directory, volatile char *memory_base_address, uint64_t code_generator_id);
+
+  [[nodiscard]] bool is_open() const;
+
+  /// Computes the 64-bit FNV-1a hash of the given bytes, continuing from the given hash.
+  static uint64_t hash(const void *data, size_t num_bytes, uint64_t seed = 0xcbf29ce484222325);
+
+  /// Loads the function stored under the given key; returns false if there is none, it was jitted for another memory
+  /// area or by another code generator, or it does not match the number of accesses.
+  bool load(uint64_t key, size_t num_accesses, Entry &entry);
+
+  /// Stores the function under the given key, replacing any previous entry.
+  void store(uint64_t key, size_t num_accesses, const Entry &entry);
+
+  /// Logs the number of functions that were loaded from and added to the cache.
+  void log_stats();
+};
+
+#endif //BLACKSMITH_INCLUDE_FUZZER_JITCODECACHE_HPP_
@@ -57,6 +57,10 @@ class PatternAddressMapper {
   // this may happen after we tested more than one pattern)
   static int bank_counter;
 
+  // a bank that is never assigned to a mapping, e.g., because the ACTs per tREFI estimator accesses it concurrently
+  // (-1 if all banks can be used)
+  static int reserved_bank;
+
   // a mapping from aggressors included in this pattern to memory addresses (DRAMAddr)
   std::unordered_map<AGGRESSOR_ID_TYPE, DRAMAddr> aggressor_to_addr;
 
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_FUZZER_PATTERNJITPIPELINE_HPP_
+#define BLACKSMITH_INCLUDE_FUZZER_PATTERNJITPIPELINE_HPP_
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Fuzzer/FuzzingParameterSet.hpp"
+#include "Fuzzer/HammeringPattern.hpp"
+#include "Fuzzer/PatternAddressMapper.hpp"
+#include "Utilities/SpscQueue.hpp"
+
+/// A mapping of a pattern to DRAM addresses whose hammering code was already jitted.
+struct JittedMapping {
+  PatternAddressMapper mapper;
+
+  // the code jitting parameters that were randomly chosen for this mapping
+  bool sync_at_each_ref = false;
+
+  int num_aggs_for_sync = 0;
+
+  // the log messages produced while creating this mapping
+  std::string log;
+};
+
+/// A generated pattern together with all of its jitted mappings, ready to be hammered.
+struct PatternJob {
+  HammeringPattern pattern;
+
+  // the parameters the pattern was generated with
+  FuzzingParameterSet fuzzing_params;
+
+  // the mappings are not copied as copying a PatternAddressMapper drops its jitted code
+  std::vector<std::unique_ptr<JittedMapping>> mappings;
+
+  // the number of consecutive mappings that are hammered at once on different banks
+  size_t num_interleaved_banks = 1;
+
+  // if num_interleaved_banks > 1, the i-th function hammers the mappings [i*num_interleaved_banks,
+  // (i+1)*num_interleaved_banks) and the mappers themselves have no jitted code
+  std::vector<std::unique_ptr<CodeJitter>> interleaved_jitters;
+
+  // the log messages produced while generating the pattern
+  std::string log;
+};
+
+/// Generates patterns, randomizes their mappings, and jits their hammering code on a background thread such that this
+/// work overlaps with hammering. Finished jobs are handed over to the hammering thread through a bounded lock-free
+/// queue. The producer does not write into the logfile, instead it captures its log messages in the jobs.
+class PatternJitPipeline {
+ private:
+  /// the producer's own parameter set, the consumer must not access it
+  FuzzingParameterSet fuzzing_params;
+
+  size_t probes_per_pattern;
+
+  size_t num_interleaved_banks;
+
+  SpscQueue<std::unique_ptr<PatternJob>> queue;
+
+  std::atomic<bool> running;
+
+  /// the number of ACTs per tREFI to be used for the next generated pattern
+  std::atomic<int> num_acts_per_trefi;
+
+  std::thread producer;
+
+  std::mt19937 gen;
+
+  /// the total time the consumer had to wait for a job
+  int64_t consumer_wait_us;
+
+  std::unique_ptr<PatternJob> create_job();
+
+  /// jits one function that hammers the last accesses.size() mappings of the job interleaved on their banks
+  void jit_interleaved_mappings(PatternJob &job, const std::vector<std::vector<volatile char *>> &accesses);
+
+  /// produces jobs until stopped, pinned to the given CPU (unless it is negative)
+  void run(int cpu);
+
+ public:
+  /// the maximum number of finished jobs; each job keeps probes_per_pattern jitted functions in memory
+  static constexpr size_t QUEUE_CAPACITY = 2;
+
+  /// if num_interleaved_banks > 1, groups of that many mappings are hammered at once by the same function, where each
+  /// mapping of a group is on a different bank
+  PatternJitPipeline(const FuzzingParameterSet &fuzzing_params, size_t probes_per_pattern,
+                     size_t num_interleaved_banks = 1);
+
+  ~PatternJitPipeline();
+
+  PatternJitPipeline(const PatternJitPipeline &) = delete;
+
+  PatternJitPipeline &operator=(const PatternJitPipeline &) = delete;
+
+  /// Starts the producer thread, pinned to a CPU of the local NUMA node other than the one the calling (pinned)
+  /// hammering thread is running on.
+  void start();
+
+  /// Stops the producer thread and discards all jobs that were not consumed yet.
+  void stop();
+
+  /// Returns the next finished job, waits if the producer did not finish it yet.
+  std::unique_ptr<PatternJob> next_job();
+
+  /// Makes all patterns generated from now on use the given number of ACTs per tREFI.
+  void set_num_activations_per_t_refi(int acts);
+
+  /// Returns the total time in microseconds that next_job had to wait for the producer.
+  [[nodiscard]] int64_t get_consumer_wait_us() const;
+
+  /// Randomizes the mapper's addresses and the mapping's code jitting parameters, returns the pattern's accesses with
+  /// these addresses.
+  static std::vector<volatile char *> prepare_mapping(HammeringPattern &pattern, FuzzingParameterSet &fuzzing_params,
+                                                     JittedMapping &mapping);
+
+  /// Randomizes the mapper's addresses, exports the pattern with these addresses, and jits the hammering code for it.
+  static void jit_mapping(HammeringPattern &pattern, FuzzingParameterSet &fuzzing_params, JittedMapping &mapping);
+};
+
+#endif //BLACKSMITH_INCLUDE_FUZZER_PATTERNJITPIPELINE_HPP_
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_FUZZER_TIMINGTRACE_HPP_
+#define BLACKSMITH_INCLUDE_FUZZER_TIMINGTRACE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef ENABLE_JSON
+#include <nlohmann/json.hpp>
+#endif
+
+/// A record written by the hammering code at each synchronization with REFRESH. The jitted code writes the fields at
+/// fixed offsets, hence their order must not be changed.
+struct TimingTraceRecord {
+  // the timestamp (rdtscp) at the beginning of the synchronization
+  uint64_t sync_begin;
+
+  // the timestamp (rdtscp) after the REFRESH was detected
+  uint64_t sync_end;
+
+  // the number of activations that remained to be done (rsi in the jitted code)
+  uint64_t remaining_acts;
+
+  // the total number of activations done for synchronization so far (edx in the jitted code)
+  uint64_t sync_acts;
+};
+
+/// The state of the ring buffer as accessed by the jitted code: num_records at offset 0 and records at offset 8.
+struct TimingTraceState {
+  // the number of records written so far, the next record is written at index num_records%CAPACITY
+  uint64_t num_records;
+
+  TimingTraceRecord *records;
+};
+
+/// The summary of a trace, as added to the mapping's JSON record.
+struct TimingTraceStats {
+  // the number of synchronizations the stats are based on
+  size_t num_syncs = 0;
+
+  // the ACTs per refresh interval achieved between the first and the last synchronization (incl. the synchronization)
+  double acts_per_trefi = 0;
+
+  // the standard deviation of the time between two synchronizations from the closest multiple of tREFI
+  double ref_jitter_ns = 0;
+
+  // the average number of cycles spent per synchronization
+  double sync_cycles = 0;
+};
+
+/// A preallocated ring buffer of TimingTraceRecords. Its state has a fixed address such that it can be embedded into
+/// the jitted code.
+class TimingTrace {
+ private:
+  std::vector<TimingTraceRecord> buffer;
+
+ public:
+  /// the number of records kept, must be a power of two
+  static constexpr size_t CAPACITY = 4096;
+
+  TimingTraceState state;
+
+  TimingTrace();
+
+  TimingTrace(const TimingTrace &) = delete;
+
+  TimingTrace &operator=(const TimingTrace &) = delete;
+
+  void reset();
+
+  /// Writes a record, this does the same as the code emitted by CodeJitter.
+  inline void record(uint64_t sync_begin, uint64_t sync_end, uint64_t remaining_acts, uint64_t sync_acts) {
+    state.records[state.num_records%CAPACITY] = {sync_begin, sync_end, remaining_acts, sync_acts};
+    state.num_records++;
+  }
+
+  /// Summarizes the records that are still in the buffer, given the TSC frequency.
+  [[nodiscard]] TimingTraceStats analyze(double cycles_per_ns) const;
+};
+
+#ifdef ENABLE_JSON
+
+void to_json(nlohmann::json &j, const TimingTraceStats &p);
+
+void from_json(const nlohmann::json &j, TimingTraceStats &p);
+
+#endif
+
+#endif //BLACKSMITH_INCLUDE_FUZZER_TIMINGTRACE_HPP_
@@ -46,9 +46,32 @@ uint64_t static inline GB(uint64_t value) {
 // number of rounds to hammer
 #define HAMMER_ROUNDS 1000000
 
-// threshold to distinguish between row buffer miss (t > THRESH) and row buffer hit (t < THRESH)
-#define THRESH 495  // worked best on DIMM 6
-//#define THRESH 430  // worked best on DIMM 18
+// threshold to distinguish between row buffer miss (t > threshold) and row buffer hit (t < threshold); only used if
+// DramAnalyzer::calibrate_threshold cannot fit the measured latency distribution
+#define DEFAULT_THRESH 495  // worked best on DIMM 6
+
+// number of random address pairs measured to calibrate the row buffer miss/hit threshold
+#define THRESH_CALIBRATION_SAMPLES 2048
+
+// width (in cycles) of the bins of the latency histogram used to calibrate the threshold
+#define THRESH_CALIBRATION_BIN_WIDTH 10
+
+// number of rounds to measure the access time of an address pair per sample of the sequential bank conflict test
+#define SPRT_ROUNDS_PER_SAMPLE 50
+
+// duration of a refresh interval (tREFI) in nanoseconds
+#define TREFI_NS 7800
+
+// access time (in cycles) of two same-bank rows above which we assume that a REFRESH was issued; only used if
+// DramAnalyzer::calibrate_ref_threshold cannot fit the measured latency distribution
+#define DEFAULT_REF_THRESH 1000
+
+// number of same-bank access pairs measured to calibrate the REFRESH threshold, i.e., several thousand tREFIs
+#define REF_CALIBRATION_SAMPLES (256*1024)
+
+// maximum number of rounds to wait for a REFRESH when synchronizing; bounds the time spent if a REFRESH is missed
+// (e.g., due to an interrupt), after which hammering continues unsynchronized until the next synchronization
+#define MAX_SYNC_ROUNDS 4096
 
 // number of conflicting addresses to be determined for each bank
 #define NUM_TARGETS 10
@@ -68,4 +91,13 @@ uint64_t static inline GB(uint64_t value) {
 // number of bytes to be allocated
 #define MEM_SIZE (GB(1))
 
+// the file that caches the results of the DRAM calibration (bank conflicts, ACTs per refresh interval) across runs
+#define CALIBRATION_CACHE_FILE "dram-calibration-cache.json"
+
+// the directory that caches the functions jitted while replaying patterns across runs (see JitCodeCache)
+#define JIT_CODE_CACHE_DIR "jit-code-cache"
+
+// maximum time to wait for khugepaged to back the memory area by huge pages if no superpages are used
+#define HUGEPAGE_WAIT_TIMEOUT_US (10*1000*1000)
+
 #endif /* GLOBAL_DEFINES */
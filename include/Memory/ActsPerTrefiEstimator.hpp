@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_MEMORY_ACTSPERTREFIESTIMATOR_HPP_
+#define BLACKSMITH_INCLUDE_MEMORY_ACTSPERTREFIESTIMATOR_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+/// Continuously estimates the number of ACTs per refresh interval on a background thread. The thread periodically
+/// measures a batch of refresh intervals by accessing two same-bank addresses and keeps an exponentially smoothed
+/// estimate together with a confidence value, both of which can be read lock-free from other threads.
+/// The bank of the two addresses must not be hammered while the estimator runs (see
+/// PatternAddressMapper::reserved_bank). As the estimator shares the memory controller with the hammering of the other
+/// banks, the estimate can still deviate from the ACTs per refresh interval of an idle system.
+class ActsPerTrefiEstimator {
+ private:
+  volatile char *addr_a;
+
+  volatile char *addr_b;
+
+  /// the estimate (upper 32 bits) and the confidence in per mille (lower 32 bits), packed to be read consistently
+  std::atomic<uint64_t> state;
+
+  std::atomic<bool> running;
+
+  std::thread worker;
+
+  /// the number of batches measured so far
+  size_t num_batches;
+
+  /// the exponentially smoothed relative deviation of the batch means from the estimate
+  double smoothed_deviation;
+
+  /// Measures the number of ACTs in num_intervals refresh intervals and stores their mean and standard deviation.
+  /// Returns false if no refresh was observed, e.g., because the thread was interrupted too often.
+  bool measure_batch(size_t num_intervals, double &mean, double &std_dev);
+
+  /// measures batches until stopped, pinned to the given CPU (unless it is negative)
+  void run(int cpu);
+
+ public:
+  /// the weight of a new batch in the exponentially smoothed estimate
+  static constexpr double SMOOTHING_FACTOR = 0.2;
+
+  /// the number of refresh intervals measured per batch
+  static constexpr size_t INTERVALS_PER_BATCH = 200;
+
+  /// the time to wait between two batches to limit the interference with the hammering
+  static constexpr size_t BATCH_PERIOD_MS = 500;
+
+  /// the relative deviation between batches at which the confidence drops to zero
+  static constexpr double MAX_RELATIVE_DEVIATION = 0.1;
+
+  /// the confidence required before the estimate is used by the fuzzer
+  static constexpr double MIN_CONFIDENCE = 0.5;
+
+  /// Creates an estimator using the two given same-bank addresses, starting at the given estimate.
+  ActsPerTrefiEstimator(volatile char *same_bank_a, volatile char *same_bank_b, size_t initial_estimate);
+
+  ~ActsPerTrefiEstimator();
+
+  ActsPerTrefiEstimator(const ActsPerTrefiEstimator &) = delete;
+
+  ActsPerTrefiEstimator &operator=(const ActsPerTrefiEstimator &) = delete;
+
+  /// Starts the background thread, pinned to a CPU of the local NUMA node other than the one the calling (pinned)
+  /// hammering thread is running on.
+  void start();
+
+  void stop();
+
+  /// Returns the current (smoothed) number of ACTs per refresh interval.
+  [[nodiscard]] size_t get_estimate() const;
+
+  /// Returns how stable the estimate was over the last batches, between 0 (unknown) and 1 (stable).
+  [[nodiscard]] double get_confidence() const;
+};
+
+#endif //BLACKSMITH_INCLUDE_MEMORY_ACTSPERTREFIESTIMATOR_HPP_
@@ -21,6 +21,9 @@
 
 #define MTX_SIZE (30)
 
+// the number of byte-sized slices of a MTX_SIZE-bit address, each slice has its own lookup table
+#define MTX_LUT_SLICES ((MTX_SIZE + 7)/8)
+
 typedef size_t mem_config_t;
 
 struct MemConfiguration {
@@ -35,6 +38,13 @@ struct MemConfiguration {
   size_t ADDR_MTX[MTX_SIZE];
 };
 
+/// Per-byte lookup tables of DRAM_MTX and ADDR_MTX: as both matrices are GF(2)-linear maps, the translation of an
+/// address is the XOR of the translations of its bytes.
+struct MemConfigLookupTables {
+  size_t DRAM_LUT[MTX_LUT_SLICES][256];
+  size_t ADDR_LUT[MTX_LUT_SLICES][256];
+};
+
 class DRAMAddr {
  private:
   // Class attributes
@@ -42,7 +52,30 @@ class DRAMAddr {
   static MemConfiguration MemConfig;
   static size_t base_msb;
 
-  [[nodiscard]] size_t linearize() const;
+  /// the number of superpages of the memory area; these are mapped contiguously starting at base_msb, rows beyond the
+  /// first superpage's rows are located in the following superpages
+  static size_t num_superpages;
+
+  /// the lookup tables of the loaded memory configuration
+  static const MemConfigLookupTables *LookupTables;
+
+  typedef void (*from_virt_fn)(const size_t *virt_addrs, DRAMAddr *dram_addrs, size_t count);
+
+  typedef void (*to_virt_fn)(const DRAMAddr *dram_addrs, size_t *virt_addrs, size_t count);
+
+  /// the translation functions instantiated for the loaded memory configuration, selected once by load_mem_config
+  static from_virt_fn from_virt_impl;
+
+  static to_virt_fn to_virt_impl;
+
+  template<const MemConfiguration &CFG, const MemConfigLookupTables &LUT>
+  static void select_translation(bool avx2);
+
+  template<const MemConfiguration &CFG, const MemConfigLookupTables &LUT, bool AVX2>
+  static void from_virt_cfg(const size_t *virt_addrs, DRAMAddr *dram_addrs, size_t count);
+
+  template<const MemConfiguration &CFG, const MemConfigLookupTables &LUT, bool AVX2>
+  static void to_virt_cfg(const DRAMAddr *dram_addrs, size_t *virt_addrs, size_t count);
 
  public:
   size_t bank{};
@@ -52,8 +85,31 @@ class DRAMAddr {
   // class methods
   static void set_base_msb(void *buff);
 
+  static void set_num_superpages(size_t num);
+
   static void load_mem_config(mem_config_t cfg);
 
+  /// Loads the given memory configuration. Configurations not known at compile time (e.g., reverse-engineered ones)
+  /// are translated via lookup tables built at runtime.
+  static void set_mem_config(const MemConfiguration &cfg);
+
+  /// Creates the memory configuration for the given bank/rank functions and row bits (e.g., as recovered by
+  /// DramAnalyzer), including the inverse mapping ADDR_MTX. All remaining bits below MTX_SIZE are column bits.
+  static MemConfiguration create_mem_config(const std::vector<uint64_t> &bank_rank_functions, uint64_t row_function);
+
+  /// Returns the number of (byte-addressable) columns of a row in the loaded memory configuration.
+  static size_t get_num_columns();
+
+  /// Returns the number of rows per bank summed over all superpages.
+  static size_t get_num_rows();
+
+  /// Returns the number of rows per bank within a single superpage.
+  static size_t get_num_rows_per_superpage();
+
+  /// Returns the row that is offset rows away from the given row. As rows of different superpages are not physically
+  /// adjacent, the result wraps around at the boundaries of the given row's superpage.
+  static size_t shift_row(size_t row, long offset);
+
   // instance methods
   DRAMAddr(size_t bk, size_t r, size_t c);
 
@@ -66,12 +122,20 @@ class DRAMAddr {
 
   [[gnu::unused]] std::string to_string();
 
-  static void initialize(uint64_t num_bank_rank_functions, volatile char *start_address);
+  static void initialize(uint64_t num_bank_rank_functions, volatile char *start_address, size_t num_superpages);
+
+  static void initialize(const MemConfiguration &cfg, volatile char *start_address, size_t num_superpages);
 
   [[nodiscard]] std::string to_string_compact() const;
 
   [[nodiscard]] void *to_virt() const;
 
+  /// Translates all given DRAM addresses to virtual addresses in a single pass and appends them to virt_addrs.
+  static void to_virt(const std::vector<DRAMAddr> &dram_addrs, std::vector<volatile char *> &virt_addrs);
+
+  /// Translates all given virtual addresses to DRAM addresses in a single pass and appends them to dram_addrs.
+  static void from_virt(const std::vector<volatile char *> &virt_addrs, std::vector<DRAMAddr> &dram_addrs);
+
   [[nodiscard]] DRAMAddr add(size_t bank_increment, size_t row_increment, size_t column_increment) const;
 
   void add_inplace(size_t bank_increment, size_t row_increment, size_t column_increment);
@@ -81,6 +145,15 @@ class DRAMAddr {
 #endif
 
   static void initialize_configs();
+
+  /// Checks that the lookup tables agree with the bit-wise matrix multiplication for all unit vectors and that
+  /// translating them forth and back yields the original address; as the translation is linear, this covers every
+  /// address of a superpage.
+  static bool check_lookup_tables();
+
+  /// Translates num_samples random addresses forth and back using both the lookup tables and the bit-wise matrix
+  /// multiplication, checks that the results agree, and logs the speed of both translation paths (see --benchmark).
+  static bool benchmark_lookup_tables(size_t num_samples);
 };
 
 #ifdef ENABLE_JSON
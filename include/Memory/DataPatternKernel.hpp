@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_MEMORY_DATAPATTERNKERNEL_HPP_
+#define BLACKSMITH_INCLUDE_MEMORY_DATAPATTERNKERNEL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class DATA_PATTERN : char {
+  ZEROES, ONES, RANDOM
+};
+
+/// Generates and verifies the data pattern we write into the hammered memory region. The expected value of each 4-byte
+/// word is computed by a stateless, counter-based PRNG that is keyed by the word's offset within the memory region.
+/// This allows us to compare memory against the expected data in SIMD registers, i.e., without first regenerating a
+/// page of reference data.
+class DataPatternKernel {
+ private:
+  /// the granularity at which the PRNG stream is keyed (i.e., each page has its own counter)
+  static constexpr uint64_t KEY_PAGE_SIZE = 4096;
+
+  typedef size_t (*find_mismatch_fn)(const volatile char *addr, uint64_t offset, size_t len);
+
+  typedef void (*fill_fn)(volatile char *addr, uint64_t offset, size_t len);
+
+  /// the implementations of find_mismatch and fill_non_temporal selected at runtime based on the CPU's supported
+  /// instruction set extensions
+  static find_mismatch_fn find_mismatch_impl;
+
+  static fill_fn fill_non_temporal_impl;
+
+  static std::string impl_name;
+
+  static DATA_PATTERN data_pattern;
+
+  static uint32_t seed;
+
+  static size_t find_mismatch_scalar(const volatile char *addr, uint64_t offset, size_t len);
+
+  static size_t find_mismatch_avx2(const volatile char *addr, uint64_t offset, size_t len);
+
+  static size_t find_mismatch_avx512(const volatile char *addr, uint64_t offset, size_t len);
+
+  static void fill_non_temporal_scalar(volatile char *addr, uint64_t offset, size_t len);
+
+  static void fill_non_temporal_avx2(volatile char *addr, uint64_t offset, size_t len);
+
+  static void fill_non_temporal_avx512(volatile char *addr, uint64_t offset, size_t len);
+
+ public:
+  /// 32-bit integer hash (lowbias32 by C. Wellons) that serves as the counter-based PRNG
+  static inline uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+  }
+
+  /// Returns the counter of the first word of the page that contains the given offset.
+  static inline uint32_t page_key(uint64_t offset) {
+    return hash32(static_cast<uint32_t>(offset/KEY_PAGE_SIZE) ^ seed);
+  }
+
+  /// Returns the 4-byte value that is expected at the given (4-byte aligned) offset of the memory region.
+  static inline uint32_t expected_value(uint64_t offset) {
+    if (data_pattern==DATA_PATTERN::ZEROES) return 0;
+    if (data_pattern==DATA_PATTERN::ONES) return 1;
+    return hash32(page_key(offset) + static_cast<uint32_t>((offset%KEY_PAGE_SIZE)/sizeof(uint32_t)));
+  }
+
+  /// Chooses the fastest implementation supported by this CPU; must be called before find_mismatch.
+  static void initialize();
+
+  static void set_data_pattern(DATA_PATTERN pattern);
+
+  static void set_seed(uint32_t new_seed);
+
+  /// Writes the expected data into [addr, addr+len), where addr is located at the given offset of the memory region.
+  static void fill(volatile char *addr, uint64_t offset, size_t len);
+
+  /// Same as fill but uses non-temporal stores that bypass the cache hierarchy. The caller must execute an sfence
+  /// before the written data is accessed by another thread.
+  static inline void fill_non_temporal(volatile char *addr, uint64_t offset, size_t len) {
+    fill_non_temporal_impl(addr, offset, len);
+  }
+
+  /// Compares [addr, addr+len) against the expected data, where addr is located at the given offset of the memory
+  /// region. Both offset and len must be multiples of 4 bytes. Returns the index of the first byte of the first
+  /// mismatching 4-byte word, or len if the whole range matches.
+  static inline size_t find_mismatch(const volatile char *addr, uint64_t offset, size_t len) {
+    return find_mismatch_impl(addr, offset, len);
+  }
+
+  [[nodiscard]] static const std::string &get_impl_name();
+};
+
+#endif //BLACKSMITH_INCLUDE_MEMORY_DATAPATTERNKERNEL_HPP_
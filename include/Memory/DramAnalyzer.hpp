@@ -7,6 +7,7 @@
 #define DRAMANALYZER
 
 #include <cinttypes>
+#include <string>
 #include <vector>
 #include <random>
 
@@ -22,24 +23,49 @@ class DramAnalyzer {
 
   volatile char *start_address;
 
-  void find_targets(std::vector<volatile char *> &target_bank);
+  /// Adds random addresses conflicting with the given bank's addresses until it contains NUM_TARGETS addresses.
+  /// Thread-safe as long as each thread uses its own bank and generator; adds the measurement rounds to num_rounds.
+  void find_targets(std::vector<volatile char *> &target_bank, std::mt19937 &rng, size_t &num_rounds);
 
   std::mt19937 gen;
 
   std::uniform_int_distribution<int> dist;
 
+  /// the access time (in cycles) above which we consider two addresses to be in the same bank (row buffer conflict)
+  int threshold;
+
+  /// the number of ACTs per refresh interval as last measured by count_acts_per_trefi or loaded from the cache
+  size_t acts_per_trefi;
+
+  /// the REFRESH threshold as last measured by calibrate_ref_threshold or loaded from the cache, 0 if unknown
+  uint64_t ref_threshold;
+
+  /// Checks whether the addresses in banks still cause bank conflicts among each other but not across banks.
+  bool validate_bank_conflicts();
+
+  /// Decides whether both addresses cause a row buffer conflict using a sequential probability ratio test: samples of
+  /// SPRT_ROUNDS_PER_SAMPLE rounds are taken until the evidence suffices to accept or reject, which only takes a few
+  /// samples for clear cases. Adds the measurement rounds to num_rounds.
+  [[nodiscard]] bool is_conflict(volatile char *a1, volatile char *a2, size_t &num_rounds) const;
+
  public:
   explicit DramAnalyzer(volatile char *target);
 
   /// Finds addresses of the same bank causing bank conflicts when accessed sequentially
   void find_bank_conflicts();
 
+  /// Measures the access time of random address pairs and fits the resulting bimodal distribution (row buffer hits vs.
+  /// row buffer conflicts) to derive the threshold that separates both. Falls back to DEFAULT_THRESH if the fit fails.
+  int calibrate_threshold();
+
+  [[nodiscard]] int get_threshold() const;
+
   /// Measures the time between accessing two addresses.
-  static int inline measure_time(volatile char *a1, volatile char *a2) {
+  static int inline measure_time(volatile char *a1, volatile char *a2, size_t rounds = DRAMA_ROUNDS) {
     uint64_t before, after;
     before = rdtscp();
     lfence();
-    for (size_t i = 0; i < DRAMA_ROUNDS; i++) {
+    for (size_t i = 0; i < rounds; i++) {
       (void)*a1;
       (void)*a2;
       clflushopt(a1);
@@ -47,15 +73,45 @@ class DramAnalyzer {
       mfence();
     }
     after = rdtscp();
-    return (int) ((after - before)/DRAMA_ROUNDS);
+    return (int) ((after - before)/rounds);
   }
 
   std::vector<uint64_t> get_bank_rank_functions();
 
+  [[nodiscard]] uint64_t get_row_function() const;
+
   void load_known_functions(int num_ranks);
 
+  /// Recovers the bank/rank functions from the bank conflict sets (DRAMA-style): the functions are the minimum-weight
+  /// basis of the GF(2) space orthogonal to the address differences within each bank. The row bits are then determined
+  /// by checking which of the remaining bits cause a row buffer conflict when flipped without changing the bank.
+  /// Returns false if the recovered functions do not separate the bank conflict sets.
+  bool recover_functions();
+
+  /// Measures the access time of two same-bank addresses and derives the threshold above which an access was delayed
+  /// by a REFRESH from the latency histogram: as the number of REFRESHes during the measurement is known (one per
+  /// tREFI), the threshold is placed into the emptiest range between the regular accesses and the delayed ones. Falls
+  /// back to DEFAULT_REF_THRESH if the histogram does not show both modes. Sets the threshold of RefTiming.
+  uint64_t calibrate_ref_threshold();
+
+  [[nodiscard]] uint64_t get_ref_threshold() const;
+
   /// Determine the number of possible activations within a refresh interval.
   size_t count_acts_per_trefi();
+
+  [[nodiscard]] size_t get_acts_per_trefi() const;
+
+  /// Returns two addresses of the same bank, e.g., to measure refresh intervals.
+  [[nodiscard]] std::pair<volatile char *, volatile char *> get_same_bank_addresses() const;
+
+  /// Restores the bank conflicts, the REFRESH threshold, and the ACTs per refresh interval from the calibration cache
+  /// file if it contains an entry for the given key and a quick probe confirms that the cached addresses still
+  /// conflict.
+  bool load_calibration(const std::string &filename, const std::string &key);
+
+  /// Stores the bank conflicts, the REFRESH threshold, and the ACTs per refresh interval in the calibration cache file
+  /// under the given key.
+  void store_calibration(const std::string &filename, const std::string &key);
 };
 
 #endif /* DRAMANALYZER */
@@ -8,15 +8,14 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include "Memory/DataPatternKernel.hpp"
 #include "Memory/DramAnalyzer.hpp"
 #include "Fuzzer/PatternAddressMapper.hpp"
 
-enum class DATA_PATTERN : char {
-  ZEROES, ONES, RANDOM
-};
-
 class Memory {
  private:
   /// the starting address of the allocated memory area
@@ -32,9 +31,19 @@ class Memory {
   // whether this memory allocation is backed up by a superage
   const bool superpage;
 
+  // the number of worker threads used to initialize the memory area (0 = one per CPU of the local NUMA node)
+  size_t num_init_threads = 0;
+
+  // serializes the checks of concurrent hammering threads as they share flipped_bits
+  std::mutex check_mutex;
+
   size_t check_memory_internal(PatternAddressMapper &mapping, const volatile char *start,
                                const volatile char *end, bool reproducibility_mode, bool verbose);
 
+  /// Checks the given range [offset, offset+len) of the memory area for bit flips and restores the expected data.
+  size_t check_range_internal(PatternAddressMapper &mapping, uint64_t offset, size_t len, bool reproducibility_mode,
+                              bool verbose);
+
  public:
 
   // the flipped bits detected during the last call to check_memory
@@ -48,12 +57,27 @@ class Memory {
 
   void initialize(DATA_PATTERN data_pattern);
 
+  void set_num_init_threads(size_t num_threads);
+
+  /// Returns the CPUs of the NUMA node the calling thread is running on that this process is allowed to run on.
+  static std::vector<int> get_numa_local_cpus();
+
+  /// Pins the calling thread to the given CPU. Threads should call this before doing any work such that they never run
+  /// on another thread's CPU. Returns whether this succeeded.
+  static bool pin_current_thread(int cpu);
+
+  /// Verifies the whole memory area against the expected data pattern and logs the achieved scan bandwidth (see
+  /// --benchmark). Returns the number of pages that do not match the expected data.
+  size_t benchmark_check_memory();
+
   size_t check_memory(const volatile char *start, const volatile char *end);
 
   size_t check_memory(PatternAddressMapper &mapping, bool reproducibility_mode, bool verbose);
 
   [[nodiscard]] volatile char *get_starting_address() const;
 
+  [[nodiscard]] size_t get_num_superpages() const;
+
   std::string get_flipped_rows_text_repr();
 };
 
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_MEMORY_PHYSICALADDRESSRESOLVER_HPP_
+#define BLACKSMITH_INCLUDE_MEMORY_PHYSICALADDRESSRESOLVER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Resolves the physical addresses of a memory region based on /proc/self/pagemap to verify that the DRAM address
+/// functions, which are applied to virtual addresses, are valid for the region. Note that the kernel only reports page
+/// frame numbers to processes having the CAP_SYS_ADMIN capability.
+class PhysicalAddressResolver {
+ private:
+  volatile char *start_address = nullptr;
+
+  size_t size = 0;
+
+  /// the page frame number of each (4 KiB) page in the region, indexed by the page's offset in the region
+  std::vector<uint64_t> pfns;
+
+ public:
+  /// Reads the page frame numbers of all pages in [start, start+region_size). Returns false if pagemap could not be
+  /// read or does not contain page frame numbers, e.g., because we are not running as root.
+  bool build_index(volatile char *start, size_t region_size);
+
+  /// Returns the number of pages in the region whose virtual and physical address differ in the lower bits given by
+  /// alignment, i.e., pages for which the DRAM functions cannot be applied to the virtual address.
+  [[nodiscard]] size_t count_misaligned_pages(size_t alignment) const;
+
+  /// Returns the number of bytes in [start, start+region_size) that are backed by transparent huge pages or
+  /// hugetlbfs pages according to /proc/self/smaps.
+  static size_t get_huge_page_backed_bytes(const volatile char *start, size_t region_size);
+};
+
+#endif //BLACKSMITH_INCLUDE_MEMORY_PHYSICALADDRESSRESOLVER_HPP_
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_MEMORY_REFTIMING_HPP_
+#define BLACKSMITH_INCLUDE_MEMORY_REFTIMING_HPP_
+
+#include <cstdint>
+
+/// The timing model of REFRESH commands shared by all code that synchronizes with them, i.e., the jitted code, the
+/// interpreter, the TraditionalHammerer, and the ACTs per tREFI measurements. An access to two same-bank rows that
+/// takes longer than the threshold is assumed to have been delayed by a REFRESH.
+class RefTiming {
+ private:
+  /// the access time (in cycles) above which we assume that a REFRESH was issued
+  static uint64_t threshold;
+
+ public:
+  /// Returns the REFRESH threshold; DEFAULT_REF_THRESH until DramAnalyzer::calibrate_ref_threshold was called or the
+  /// threshold was restored from the calibration cache.
+  static inline uint64_t get_threshold() {
+    return threshold;
+  }
+
+  /// Sets the REFRESH threshold; must be called before any thread synchronizes with REFRESH.
+  static void set_threshold(uint64_t cycles);
+
+  /// Checks whether an access (pair) that took the given number of cycles was delayed by a REFRESH.
+  static inline bool is_refresh(uint64_t cycles) {
+    return cycles > threshold;
+  }
+};
+
+#endif //BLACKSMITH_INCLUDE_MEMORY_REFTIMING_HPP_
@@ -31,6 +31,27 @@
 #endif
 }
 
+[[gnu::unused]] static inline __attribute__((always_inline)) void clwb(volatile void *p) {
+  asm volatile("clwb (%0)\n"::"r"(p)
+  : "memory");
+}
+
+[[gnu::unused]] static inline __attribute__((always_inline)) void prefetchnta(volatile void *p) {
+  asm volatile("prefetchnta (%0)\n"::"r"(p)
+  : "memory");
+}
+
+[[gnu::unused]] static inline __attribute__((always_inline)) void nontemporal_load(volatile void *p) {
+  asm volatile("movntdqa (%0), %%xmm0\n"::"r"(p)
+  : "xmm0", "memory");
+}
+
+// a read-modify-write that does not change the data but makes the cache line dirty
+[[gnu::unused]] static inline __attribute__((always_inline)) void add_zero(volatile void *p) {
+  asm volatile("addq $0, (%0)\n"::"r"(p)
+  : "cc", "memory");
+}
+
 [[gnu::unused]] static inline __attribute__((always_inline)) void cpuid() {
   asm volatile("cpuid"::
   : "rax", "rbx", "rcx", "rdx");
@@ -33,6 +33,40 @@ std::string to_string(FENCING_STRATEGY strategy);
 
 void from_string(const std::string &strategy, FENCING_STRATEGY &dest);
 
+enum class ACCESS_STRATEGY : int {
+  // activate the aggressor's row by a plain load
+  LOAD = 0,
+  // use a non-temporal load (movntdqa), requires SSE4.1
+  NONTEMPORAL_LOAD = 1,
+  // prefetch the aggressor with a non-temporal hint instead of waiting for the data
+  PREFETCHNTA = 2,
+  // do a read-modify-write that adds zero, i.e., the line is dirty and written back when it is flushed
+  STORE = 3
+};
+
+std::string to_string(ACCESS_STRATEGY strategy);
+
+void from_string(const std::string &strategy, ACCESS_STRATEGY &dest);
+
+enum class FLUSH_INSTRUCTION : int {
+  CLFLUSH = 0,
+  // weakly ordered version of clflush, requires the CLFLUSHOPT CPU feature
+  CLFLUSHOPT = 1,
+  // writes a dirty line back, depending on the CPU the line is not evicted, requires the CLWB CPU feature
+  CLWB = 2
+};
+
+std::string to_string(FLUSH_INSTRUCTION instruction);
+
+void from_string(const std::string &instruction, FLUSH_INSTRUCTION &dest);
+
+/// returns the access strategies supported by the CPU we are running on (determined using cpuid)
+const std::vector<ACCESS_STRATEGY> &get_supported_access_strategies();
+
+/// returns the flush instructions supported by the CPU we are running on (determined using cpuid), the first one is
+/// the preferred instruction to evict a cache line
+const std::vector<FLUSH_INSTRUCTION> &get_supported_flush_instructions();
+
 std::vector<std::pair<FLUSHING_STRATEGY, FENCING_STRATEGY>> get_valid_strategies();
 
 [[maybe_unused]] std::pair<FLUSHING_STRATEGY, FENCING_STRATEGY> get_valid_strategy_pair();
@@ -9,6 +9,7 @@
 #include <string>
 #include <fstream>
 #include <memory>
+#include <sstream>
 
 template<typename ... Args>
 std::string format_string(const std::string &format, Args ... args) {
@@ -33,12 +34,25 @@ class Logger {
 
   unsigned long timestamp_start{};
 
+  // if set, the messages of the calling thread are written into this buffer instead of the logfile
+  static thread_local std::unique_ptr<std::ostringstream> capture_buffer;
+
+  static std::ostream &out();
+
  public:
 
   static void initialize();
 
   static void close();
 
+  // redirects all messages logged by the calling thread into a buffer until end_capture is called; this allows
+  // background threads to prepare their log output and to write it later (e.g., using log_data) without interleaving
+  // it with the messages of other threads
+  static void begin_capture();
+
+  // stops capturing the messages of the calling thread and returns the captured messages
+  static std::string end_capture();
+
   static void log_info(const std::string &message, bool newline = true);
 
   static void log_highlight(const std::string &message, bool newline = true);
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2021 by ETH Zurich.
+ * Licensed under the MIT License, see LICENSE file for more details.
+ */
+
+#ifndef BLACKSMITH_INCLUDE_UTILITIES_SPSCQUEUE_HPP_
+#define BLACKSMITH_INCLUDE_UTILITIES_SPSCQUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/// A bounded lock-free queue for exactly one producer thread and one consumer thread. Neither side ever blocks: if the
+/// queue is full (empty), try_push (try_pop) returns false and the caller decides how to wait.
+template<typename T>
+class SpscQueue {
+ private:
+  /// one slot more than the capacity to distinguish a full queue from an empty one
+  std::vector<T> slots;
+
+  /// the slot to be read next, only written by the consumer
+  alignas(64) std::atomic<size_t> head;
+
+  /// the slot to be written next, only written by the producer
+  alignas(64) std::atomic<size_t> tail;
+
+ public:
+  explicit SpscQueue(size_t capacity) : slots(capacity + 1), head(0), tail(0) {
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  /// Moves the item into the queue. Returns false (and leaves the item untouched) if the queue is full.
+  bool try_push(T &&item) {
+    const auto cur_tail = tail.load(std::memory_order_relaxed);
+    const auto next_tail = (cur_tail + 1)%slots.size();
+    if (next_tail==head.load(std::memory_order_acquire)) return false;
+    slots[cur_tail] = std::move(item);
+    tail.store(next_tail, std::memory_order_release);
+    return true;
+  }
+
+  /// Moves the oldest item out of the queue. Returns false if the queue is empty.
+  bool try_pop(T &item) {
+    const auto cur_head = head.load(std::memory_order_relaxed);
+    if (cur_head==tail.load(std::memory_order_acquire)) return false;
+    item = std::move(slots[cur_head]);
+    head.store((cur_head + 1)%slots.size(), std::memory_order_release);
+    return true;
+  }
+
+  /// Returns the number of items in the queue; only exact if called while neither side modifies the queue.
+  [[nodiscard]] size_t size() const {
+    const auto cur_head = head.load(std::memory_order_acquire);
+    const auto cur_tail = tail.load(std::memory_order_acquire);
+    return (cur_tail + slots.size() - cur_head)%slots.size();
+  }
+};
+
+#endif //BLACKSMITH_INCLUDE_UTILITIES_SPSCQUEUE_HPP_
@@ -1,6 +1,7 @@
 #include "Blacksmith.hpp"
 
 #include <sys/resource.h>
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
 #include <memory>
@@ -10,13 +11,14 @@
 
 #include "Forges/TraditionalHammerer.hpp"
 #include "Forges/FuzzyHammerer.hpp"
+#include "Utilities/TimeHelper.hpp"
 
 #include <argagg/argagg.hpp>
 #include <argagg/convert/csv.hpp>
 
 ProgramArguments program_args;
 
-int check_cpu() {
+std::string get_cpu_model() {
   std::array<char, 128> buffer{};
   std::string cpu_model;
   std::unique_ptr<FILE, decltype(&pclose)> pipe(popen("cat /proc/cpuinfo | grep \"model name\" | cut -d':' -f2 | awk '{$1=$1;print}' | head -1", "r"), pclose);
@@ -26,6 +28,20 @@ int check_cpu() {
   while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
     cpu_model += buffer.data();
   }
+  // remove the trailing newline
+  cpu_model.erase(cpu_model.find_last_not_of('\n') + 1);
+  return cpu_model;
+}
+
+std::string get_calibration_key() {
+  const size_t mem_config = CHANS(CHANNEL) | DIMMS(DIMM) | RANKS(static_cast<size_t>(program_args.num_ranks))
+      | BANKS(NUM_BANKS);
+  return format_string("%s|dimm=%ld|ranks=%d|memcfg=0x%zx",
+      get_cpu_model().c_str(), program_args.dimm_id, program_args.num_ranks, mem_config);
+}
+
+bool check_cpu() {
+  auto cpu_model = get_cpu_model();
 
   Logger::log_info("Detecting CPU model:");
   Logger::log_data(format_string("%s", cpu_model.c_str()));
@@ -50,8 +66,8 @@ int check_cpu() {
   }
 
   if (!cpu_supported) {
-    Logger::log_error("CPU model is not supported. You need to run DRAMA to update the DRAM address matrices. See the README.md for details.");
-    exit(EXIT_FAILURE);
+    Logger::log_info("CPU model is not supported by the hard-coded DRAM address matrices. "
+                     "Will recover the bank/rank and row functions from the bank conflicts instead.");
   }
 
   return cpu_supported;
@@ -61,7 +77,7 @@ int main(int argc, char **argv) {
   Logger::initialize();
 
   // check if the system's CPU is supported by our hard-coded DRAM address matrices
-  check_cpu();
+  const bool cpu_supported = check_cpu();
 
   handle_args(argc, argv);
 
@@ -74,23 +90,60 @@ int main(int argc, char **argv) {
 
   // allocate a large bulk of contiguous memory
   Memory memory(true);
-  memory.allocate_memory(MEM_SIZE);
+  memory.set_num_init_threads(program_args.num_init_threads);
+  memory.allocate_memory(program_args.num_superpages*MEM_SIZE);
+  if (program_args.run_benchmarks) {
+    // check the whole memory area once; this makes sure that the data pattern is consistent and reports the bandwidth
+    // of the bit flip check
+    memory.benchmark_check_memory();
+  }
 
-  // find address sets that create bank conflicts
+  // find address sets that create bank conflicts, unless we can restore them from a previous run on this machine
+  const auto calibration_start_ts = get_timestamp_us();
+  const auto calibration_key = get_calibration_key();
   DramAnalyzer dram_analyzer(memory.get_starting_address());
-  dram_analyzer.find_bank_conflicts();
-  if (program_args.num_ranks != 0) {
+  const bool calibration_cached = !program_args.recalibrate
+      && dram_analyzer.load_calibration(CALIBRATION_CACHE_FILE, calibration_key);
+  if (!calibration_cached) dram_analyzer.find_bank_conflicts();
+  // initialize the DRAMAddr class to load the proper memory configuration: use the hard-coded functions if we know
+  // them for this CPU and DIMM, otherwise reverse-engineer them from the bank conflicts
+  if (cpu_supported && program_args.num_ranks!=0) {
     dram_analyzer.load_known_functions(program_args.num_ranks);
+    DRAMAddr::initialize(dram_analyzer.get_bank_rank_functions().size(), memory.get_starting_address(),
+        memory.get_num_superpages());
   } else {
-    Logger::log_error("Program argument '--ranks <integer>' was probably not passed. Cannot continue.");
-    exit(EXIT_FAILURE);
+    if (!dram_analyzer.recover_functions()) {
+      Logger::log_error("Could not recover the bank/rank and row functions. "
+                        "Try again with --recalibrate or update the DRAM address matrices manually.");
+      exit(EXIT_FAILURE);
+    }
+    DRAMAddr::initialize(DRAMAddr::create_mem_config(dram_analyzer.get_bank_rank_functions(),
+        dram_analyzer.get_row_function()), memory.get_starting_address(), memory.get_num_superpages());
+  }
+  if (program_args.run_benchmarks) DRAMAddr::benchmark_lookup_tables(1000000);
+
+  // calibrate the access time that indicates a REFRESH, which all synchronization with REFRESH (including the
+  // measurement of the ACTs per refresh interval) relies on, unless it was cached
+  bool ref_threshold_measured = false;
+  if (dram_analyzer.get_ref_threshold()==0) {
+    dram_analyzer.calibrate_ref_threshold();
+    ref_threshold_measured = true;
   }
-  // initialize the DRAMAddr class to load the proper memory configuration
-  DRAMAddr::initialize(dram_analyzer.get_bank_rank_functions().size(), memory.get_starting_address());
 
-  // count the number of possible activations per refresh interval, if not given as program argument
-  if (program_args.acts_per_trefi==0)
-    program_args.acts_per_trefi = dram_analyzer.count_acts_per_trefi();
+  // count the number of possible activations per refresh interval, if not given as program argument or cached
+  bool acts_measured = false;
+  if (program_args.acts_per_trefi==0) {
+    program_args.acts_per_trefi = dram_analyzer.get_acts_per_trefi();
+    if (program_args.acts_per_trefi==0) {
+      program_args.acts_per_trefi = dram_analyzer.count_acts_per_trefi();
+      acts_measured = true;
+    }
+  }
+  if (!calibration_cached || acts_measured || ref_threshold_measured)
+    dram_analyzer.store_calibration(CALIBRATION_CACHE_FILE, calibration_key);
+  Logger::log_info(format_string("DRAM calibration took %.2f ms (%s).",
+      static_cast<double>(get_timestamp_us() - calibration_start_ts)/1000.0,
+      calibration_cached ? "restored from cache" : "full calibration"));
 
   if (!program_args.load_json_filename.empty()) {
     ReplayingHammerer replayer(memory);
@@ -138,7 +191,7 @@ void handle_args(int argc, char **argv) {
   argagg::parser argparser{{
       {"help", {"-h", "--help"}, "shows this help message", 0},
       {"dimm-id", {"-d", "--dimm-id"}, "internal identifier of the currently inserted DIMM (default: 0)", 1},
-      {"ranks", {"-r", "--ranks"}, "number of ranks on the DIMM, used to determine bank/rank/row functions, assumes Intel Coffe Lake CPU (default: None)", 1},
+      {"ranks", {"-r", "--ranks"}, "number of ranks on the DIMM, used to determine bank/rank/row functions, assumes Intel Coffe Lake CPU; if absent, the functions are reverse-engineered (default: None)", 1},
 
       {"fuzzing", {"-f", "--fuzzing"}, "perform a fuzzing run (default program mode)", 0},
       {"generate-patterns", {"-g", "--generate-patterns"}, "generates N patterns, but does not perform hammering; used by ARM port", 1},
@@ -153,6 +206,14 @@ void handle_args(int argc, char **argv) {
       {"runtime-limit", {"-t", "--runtime-limit"}, "number of seconds to run the fuzzer before sweeping/terminating (default: 120)", 1},
       {"acts-per-ref", {"-a", "--acts-per-ref"}, "number of activations in a tREF interval, i.e., 7.8us (default: None)", 1},
       {"probes", {"-p", "--probes"}, "number of different DRAM locations to try each pattern on (default: NUM_BANKS/4)", 1},
+      {"recalibrate", {"-c", "--recalibrate"}, "ignore the DRAM calibration cache and redo the calibration (default: absent)", 0},
+      {"superpages", {"-n", "--superpages"}, "number of 1 GB superpages to allocate and hammer on (default: 1)", 1},
+      {"init-threads", {"-i", "--init-threads"}, "number of threads used to initialize the memory (default: one per CPU of the local NUMA node)", 1},
+      {"interleave-banks", {"-k", "--interleave-banks"}, "number of mappings of a pattern hammered at once by one function, each on a different bank (default: 1)", 1},
+      {"hammer-threads", {"-u", "--hammer-threads"}, "number of threads hammering patterns on different banks at the same time, 0 picks the number that maximizes the probes per hour (default: 1)", 1},
+      {"interpret", {"-x", "--interpret"}, "execute the hammering patterns with the interpreter instead of jitting code (default: absent, always present if built without jitting)", 0},
+      {"benchmark", {"-b", "--benchmark"}, "run the micro-benchmarks of the memory check and the DRAM address translation after initializing the memory (default: absent)", 0},
+      {"trace", {"-e", "--trace"}, "record the timing of each REFRESH synchronization while hammering and add the achieved ACTs per tREFI, the REF jitter, and the sync cycles to the JSON output (default: absent)", 0},
     }};
 
   argagg::parser_results parsed_args;
@@ -179,17 +240,12 @@ void handle_args(int argc, char **argv) {
     exit(EXIT_FAILURE);
   }
 
-  if (parsed_args.has_option("ranks")) {
-    program_args.num_ranks = parsed_args["ranks"].as<int>(0);
-    Logger::log_debug(format_string("Set --ranks=%d", program_args.num_ranks));
-  } else {
-    Logger::log_error("Program argument '--ranks <integer>' is mandatory! Cannot continue.");
-    exit(EXIT_FAILURE);
-  }
-
   /**
   * optional parameters
   */
+  program_args.num_ranks = parsed_args["ranks"].as<int>(program_args.num_ranks);
+  Logger::log_debug(format_string("Set --ranks=%d", program_args.num_ranks));
+
   program_args.sweeping = parsed_args.has_option("sweeping") || program_args.sweeping;
   Logger::log_debug(format_string("Set --sweeping=%s", (program_args.sweeping ? "true" : "false")));
 
@@ -204,6 +260,31 @@ void handle_args(int argc, char **argv) {
   program_args.num_address_mappings_per_pattern = parsed_args["probes"].as<size_t>(program_args.num_address_mappings_per_pattern);
   Logger::log_debug(format_string("Set --probes=%d", program_args.num_address_mappings_per_pattern));
 
+  program_args.recalibrate = parsed_args.has_option("recalibrate");
+  Logger::log_debug(format_string("Set --recalibrate=%s", (program_args.recalibrate ? "true" : "false")));
+
+  program_args.num_superpages = std::max<size_t>(1, parsed_args["superpages"].as<size_t>(program_args.num_superpages));
+  Logger::log_debug(format_string("Set --superpages=%lu", program_args.num_superpages));
+
+  program_args.num_init_threads = parsed_args["init-threads"].as<size_t>(program_args.num_init_threads);
+  Logger::log_debug(format_string("Set --init-threads=%lu", program_args.num_init_threads));
+
+  program_args.num_interleaved_banks = std::clamp<size_t>(
+      parsed_args["interleave-banks"].as<size_t>(program_args.num_interleaved_banks), 1, NUM_BANKS);
+  Logger::log_debug(format_string("Set --interleave-banks=%lu", program_args.num_interleaved_banks));
+
+  program_args.num_hammer_threads = parsed_args["hammer-threads"].as<size_t>(program_args.num_hammer_threads);
+  Logger::log_debug(format_string("Set --hammer-threads=%lu", program_args.num_hammer_threads));
+
+  CodeJitter::use_interpreter = parsed_args.has_option("interpret") || CodeJitter::use_interpreter;
+  Logger::log_debug(format_string("Set --interpret=%s", (CodeJitter::use_interpreter ? "true" : "false")));
+
+  program_args.run_benchmarks = parsed_args.has_option("benchmark");
+  Logger::log_debug(format_string("Set --benchmark=%s", (program_args.run_benchmarks ? "true" : "false")));
+
+  CodeJitter::use_timing_trace = parsed_args.has_option("trace");
+  Logger::log_debug(format_string("Set --trace=%s", (CodeJitter::use_timing_trace ? "true" : "false")));
+
   /**
    * program modes
    */
@@ -1,10 +1,57 @@
 #include "Forges/FuzzyHammerer.hpp"
 
 #include <Blacksmith.hpp>
+#include <sched.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
 
 #include "Utilities/TimeHelper.hpp"
 #include "Fuzzer/PatternBuilder.hpp"
 #include "Forges/ReplayingHammerer.hpp"
+#include "Fuzzer/PatternJitPipeline.hpp"
+#include "Forges/HammerWorkerPool.hpp"
+
+namespace {
+
+/// mappings of a job that are hammered together by the same function, i.e., a single mapping or a group of mappings
+/// that are interleaved on different banks
+struct ProbeUnit {
+  size_t first_mapping;
+
+  size_t num_mappings;
+
+  CodeJitter *code_jitter;
+};
+
+std::vector<ProbeUnit> get_probe_units(PatternJob &job) {
+  std::vector<ProbeUnit> units;
+  if (job.interleaved_jitters.empty()) {
+    for (size_t i = 0; i < job.mappings.size(); ++i) {
+      units.push_back({i, 1, &job.mappings[i]->mapper.get_code_jitter()});
+    }
+  } else {
+    for (size_t g = 0; g < job.interleaved_jitters.size(); ++g) {
+      const size_t first = g*job.num_interleaved_banks;
+      units.push_back({first, std::min(job.num_interleaved_banks, job.mappings.size() - first),
+                       job.interleaved_jitters[g].get()});
+    }
+  }
+  return units;
+}
+
+/// a job whose probes were handed to the hammering threads
+struct HammeredJob {
+  std::unique_ptr<PatternJob> job;
+
+  // the number of flipped bits of each mapping
+  std::vector<size_t> flipped_bits;
+
+  // the number of probe units that did not finish yet
+  std::atomic<size_t> remaining_units{0};
+};
+
+}
 
 // initialize the static variables
 size_t FuzzyHammerer::cnt_pattern_probes = 0UL;
@@ -26,6 +73,41 @@ void FuzzyHammerer::n_sided_frequency_based_hammering(DramAnalyzer &dramAnalyzer
   FuzzingParameterSet fuzzing_params(acts);
   fuzzing_params.print_static_parameters();
 
+  // pin the hammering thread first: all background threads pick their CPUs relative to the one we are running on,
+  // which is only meaningful as long as we cannot migrate to another CPU
+  const int hammer_cpu = sched_getcpu();
+  if (hammer_cpu >= 0 && Memory::pin_current_thread(hammer_cpu)) {
+    Logger::log_info(format_string("Pinned hammering thread to CPU %d.", hammer_cpu));
+  } else {
+    Logger::log_error("Could not pin the hammering thread, the background threads may share its CPU.");
+  }
+
+  // hammer several patterns at once on different banks if requested; this must be set up before starting any other
+  // background thread as these would disturb the calibration
+  std::unique_ptr<HammerWorkerPool> worker_pool;
+  if (program_args.num_hammer_threads!=1) {
+    auto cpus = HammerWorkerPool::get_worker_cpus();
+    const size_t num_threads = (program_args.num_hammer_threads==0)
+                               ? HammerWorkerPool::calibrate_num_workers(cpus, cpus.size(), memory)
+                               : std::min(program_args.num_hammer_threads, cpus.size());
+    if (num_threads > 1) {
+      cpus.resize(num_threads);
+      worker_pool = std::make_unique<HammerWorkerPool>(cpus);
+    } else {
+      Logger::log_info("Hammering on a single thread as there are not enough CPUs or multiple threads do not pay off.");
+    }
+  }
+
+  // keep track of the number of ACTs per tREF in the background, unless the user provided a fixed value
+  auto same_bank_addrs = dramAnalyzer.get_same_bank_addresses();
+  ActsPerTrefiEstimator acts_estimator(same_bank_addrs.first, same_bank_addrs.second, static_cast<size_t>(acts));
+  if (!program_args.fixed_acts_per_ref) {
+    // the estimator keeps accessing its bank while we are hammering, hence we exclude this bank from the mappings as
+    // hammering it would skew both the estimate and the hammering
+    PatternAddressMapper::reserved_bank = static_cast<int>(DRAMAddr((void *) same_bank_addrs.first).bank);
+    acts_estimator.start();
+  }
+
   ReplayingHammerer replaying_hammerer(memory);
 
 #ifdef ENABLE_JSON
@@ -44,34 +126,16 @@ void FuzzyHammerer::n_sided_frequency_based_hammering(DramAnalyzer &dramAnalyzer
   const auto start_ts = get_timestamp_sec();
   const auto execution_time_limit = static_cast<int64_t>(start_ts + runtime_limit);
 
-  for (; get_timestamp_sec() < execution_time_limit; ++cnt_generated_patterns) {
-    Logger::log_timestamp();
-    Logger::log_highlight(format_string("Generating hammering pattern #%lu.", cnt_generated_patterns));
-    fuzzing_params.randomize_parameters(true);
-
-    // generate a hammering pattern: this is like a general access pattern template without concrete addresses
-    FuzzyHammerer::hammering_pattern = HammeringPattern(fuzzing_params.get_base_period());
-    PatternBuilder pattern_builder(hammering_pattern);
-    pattern_builder.generate_frequency_based_pattern(fuzzing_params);
-
-    Logger::log_info("Abstract pattern based on aggressor IDs:");
-    Logger::log_data(hammering_pattern.get_pattern_text_repr());
-    Logger::log_info("Aggressor pairs, given as \"(id ...) : freq, amp, start_offset\":");
-    Logger::log_data(hammering_pattern.get_agg_access_pairs_text_repr());
-
-    // randomize the order of AggressorAccessPatterns to avoid biasing the PatternAddressMapper as it always assigns
-    // rows in order of the AggressorAccessPatterns map (e.g., first element is assigned to the lowest DRAM row).]
-    std::shuffle(hammering_pattern.agg_access_patterns.begin(), hammering_pattern.agg_access_patterns.end(), gen);
-
-    // then test this pattern with N different mappings (i.e., address sets)
+  // collects the bit flips of all mappings of a hammered pattern and keeps track of the best pattern and mapping
+  auto evaluate_job = [&](PatternJob &job, const std::vector<size_t> &flipped_bits) {
+    FuzzyHammerer::hammering_pattern = job.pattern;
     size_t sum_flips_one_pattern_all_mappings = 0;
-    for (cnt_pattern_probes = 0; cnt_pattern_probes < probes_per_pattern; ++cnt_pattern_probes) {
-      PatternAddressMapper mapper;
-//      Logger::log_info(format_string("Running pattern #%lu (%s) for address set %d (%s).",
-//          current_round, hammering_pattern.instance_id.c_str(), cnt_pattern_probes, mapper.get_instance_id().c_str()));
-//
-      // we test this combination of (pattern, mapping) at three different DRAM locations
-      probe_mapping_and_scan(mapper, memory, fuzzing_params, program_args.num_dram_locations_per_mapping);
+    for (cnt_pattern_probes = 0; cnt_pattern_probes < job.mappings.size(); ++cnt_pattern_probes) {
+      PatternAddressMapper &mapper = job.mappings[cnt_pattern_probes]->mapper;
+
+      // store info about this bit flip (pattern ID, mapping ID, no. of bit flips)
+      map_pattern_mappings_bitflips[hammering_pattern.instance_id].emplace(mapper.get_instance_id(),
+          flipped_bits[cnt_pattern_probes]);
       sum_flips_one_pattern_all_mappings += mapper.count_bitflips();
 
       if (sum_flips_one_pattern_all_mappings > 0) {
@@ -103,21 +167,107 @@ void FuzzyHammerer::n_sided_frequency_based_hammering(DramAnalyzer &dramAnalyzer
         }
       }
     }
+  };
+
+  // the patterns whose probes were handed to the hammering threads, in the order they were generated
+  std::deque<std::unique_ptr<HammeredJob>> hammered_jobs;
+
+  // writes the output of the hammering threads and evaluates the oldest patterns if all of their probes finished
+  auto collect_hammered_jobs = [&]() {
+    for (const auto &log : worker_pool->take_logs()) Logger::log_data(log, false);
+    while (!hammered_jobs.empty() && hammered_jobs.front()->remaining_units.load()==0) {
+      evaluate_job(*hammered_jobs.front()->job, hammered_jobs.front()->flipped_bits);
+      hammered_jobs.pop_front();
+    }
+  };
+
+  // patterns are generated and jitted in the background while we are hammering the previous pattern
+  PatternJitPipeline pipeline(fuzzing_params, probes_per_pattern, program_args.num_interleaved_banks);
+  pipeline.start();
+
+  for (; get_timestamp_sec() < execution_time_limit; ++cnt_generated_patterns) {
+    auto job = pipeline.next_job();
+    Logger::log_timestamp();
+    Logger::log_highlight(format_string("Generating hammering pattern #%lu.", cnt_generated_patterns));
+    Logger::log_data(job->log, false);
+    fuzzing_params = job->fuzzing_params;
+
+    // then test this pattern with N different mappings (i.e., address sets)
+    const auto units = get_probe_units(*job);
+    if (!worker_pool) {
+      std::vector<size_t> flipped_bits(job->mappings.size(), 0);
+      for (const auto &unit : units) {
+        for (size_t i = unit.first_mapping; i < unit.first_mapping + unit.num_mappings; ++i) {
+          Logger::log_data(job->mappings[i]->log, false);
+        }
+        // we test this combination of (pattern, mapping) at three different DRAM locations
+        auto unit_flipped_bits = probe_mappings_and_scan(*job, unit.first_mapping, unit.num_mappings,
+            *unit.code_jitter, memory, fuzzing_params, cnt_generated_patterns);
+        std::copy(unit_flipped_bits.begin(), unit_flipped_bits.end(), flipped_bits.begin() + unit.first_mapping);
+      }
+      evaluate_job(*job, flipped_bits);
+    } else {
+      auto hammered_job = std::make_unique<HammeredJob>();
+      hammered_job->flipped_bits.assign(job->mappings.size(), 0);
+      hammered_job->remaining_units = units.size();
+      hammered_job->job = std::move(job);
+      for (const auto &unit : units) {
+        std::vector<int> banks;
+        for (size_t i = unit.first_mapping; i < unit.first_mapping + unit.num_mappings; ++i) {
+          banks.push_back(hammered_job->job->mappings[i]->mapper.bank_no);
+        }
+        // each task gets its own copy of the parameters as they contain the random generator
+        worker_pool->submit([&memory, hj = hammered_job.get(), unit, params = fuzzing_params,
+                                pattern_no = cnt_generated_patterns]() mutable {
+          for (size_t i = unit.first_mapping; i < unit.first_mapping + unit.num_mappings; ++i) {
+            Logger::log_data(hj->job->mappings[i]->log, false);
+          }
+          auto unit_flipped_bits = probe_mappings_and_scan(*hj->job, unit.first_mapping, unit.num_mappings,
+              *unit.code_jitter, memory, params, pattern_no);
+          std::copy(unit_flipped_bits.begin(), unit_flipped_bits.end(), hj->flipped_bits.begin() + unit.first_mapping);
+          hj->remaining_units.fetch_sub(1);
+        }, banks);
+      }
+      hammered_jobs.push_back(std::move(hammered_job));
+
+      // only take the next pattern once a hammering thread would otherwise be idle
+      worker_pool->wait_for_idle_worker();
+      collect_hammered_jobs();
+    }
 
     // dynamically change num acts per tREF after every 100 patterns; this is to avoid that we made a bad choice at the
     // beginning and then get stuck with that value
     // if the user provided a fixed num acts per tREF value via the program arguments, then we will not change it
     if (cnt_generated_patterns%100==0 && !program_args.fixed_acts_per_ref) {
       auto old_nacts = fuzzing_params.get_num_activations_per_t_refi();
-      // repeat measuring the number of possible activations per tREF as it might be that the current value is not optimal
-      fuzzing_params.set_num_activations_per_t_refi(static_cast<int>(dramAnalyzer.count_acts_per_trefi()));
-      Logger::log_info(
-          format_string("Recomputed number of ACTs per tREF (old: %d, new: %d).",
-              old_nacts,
-              fuzzing_params.get_num_activations_per_t_refi()));
+      // take over the background estimate, which does not require us to stop fuzzing for a new measurement
+      if (fuzzing_params.set_num_activations_per_t_refi(acts_estimator)) {
+        Logger::log_info(
+            format_string("Updated number of ACTs per tREF (old: %d, new: %d, confidence: %.2f).",
+                old_nacts,
+                fuzzing_params.get_num_activations_per_t_refi(),
+                acts_estimator.get_confidence()));
+        pipeline.set_num_activations_per_t_refi(fuzzing_params.get_num_activations_per_t_refi());
+      } else {
+        Logger::log_info(format_string("Keeping number of ACTs per tREF (%d) as the estimate is not confident yet "
+                                       "(confidence: %.2f).", old_nacts, acts_estimator.get_confidence()));
+      }
     }
 
   } // end of fuzzing
+  if (worker_pool) {
+    worker_pool->wait_all();
+    collect_hammered_jobs();
+    worker_pool.reset();
+  }
+  pipeline.stop();
+  acts_estimator.stop();
+  PatternAddressMapper::reserved_bank = -1;
+
+  const auto fuzzing_time_sec = std::max<int64_t>(1, get_timestamp_sec() - start_ts);
+  Logger::log_info(format_string("Pattern throughput: %.1f patterns/hour (waited %.1f s for pattern jitting).",
+      static_cast<double>(cnt_generated_patterns)*3600.0/static_cast<double>(fuzzing_time_sec),
+      static_cast<double>(pipeline.get_consumer_wait_us())/1000000.0));
 
   log_overall_statistics(
       cnt_generated_patterns,
@@ -283,76 +433,79 @@ void FuzzyHammerer::test_location_dependence(ReplayingHammerer &rh, HammeringPat
   pattern.is_location_dependent = is_location_dependent;
 }
 
-void FuzzyHammerer::probe_mapping_and_scan(PatternAddressMapper &mapper, Memory &memory,
-                                           FuzzingParameterSet &fuzzing_params, size_t num_dram_locations) {
-
-  // ATTENTION: This method uses the global variable hammering_pattern to refer to the pattern that is to be hammered
-
-  CodeJitter &code_jitter = mapper.get_code_jitter();
-
-  // randomize the aggressor ID -> DRAM row mapping
-  mapper.randomize_addresses(fuzzing_params, hammering_pattern.agg_access_patterns, true);
-
-  // now fill the pattern with these random addresses
-  std::vector<volatile char *> hammering_accesses_vec;
-  mapper.export_pattern(hammering_pattern.aggressors, hammering_pattern.base_period, hammering_accesses_vec);
-  Logger::log_info("Aggressor ID to DRAM address mapping (bank, row, column):");
-  Logger::log_data(mapper.get_mapping_text_repr());
-
-  // now create instructions that follow this pattern (i.e., do jitting of code)
-  bool sync_at_each_ref = fuzzing_params.get_random_sync_each_ref();
-  int num_aggs_for_sync = fuzzing_params.get_random_num_aggressors_for_sync();
-  Logger::log_info("Creating ASM code for hammering.");
-  code_jitter.jit_strict(fuzzing_params.get_num_activations_per_t_refi(),
-      fuzzing_params.flushing_strategy, fuzzing_params.fencing_strategy,
-      hammering_accesses_vec, sync_at_each_ref, num_aggs_for_sync,
-      fuzzing_params.get_hammering_total_num_activations());
-
-  size_t flipped_bits = 0;
-  for (size_t dram_location = 0; dram_location < num_dram_locations; ++dram_location) {
-    mapper.bit_flips.emplace_back();
-
-    Logger::log_info(format_string("Running pattern #%lu (%s) for address set %d (%s) at DRAM location #%ld.",
-        cnt_generated_patterns,
-        hammering_pattern.instance_id.c_str(),
-        cnt_pattern_probes,
-        mapper.get_instance_id().c_str(),
-        dram_location));
+std::vector<size_t> FuzzyHammerer::probe_mappings_and_scan(PatternJob &job, size_t first_mapping, size_t num_mappings,
+                                                           CodeJitter &code_jitter, Memory &memory,
+                                                           FuzzingParameterSet &fuzzing_params, size_t pattern_no) {
+
+  // ATTENTION: This method may run on several hammering threads at once, hence it must not use any of the static
+  // variables; it expects the hammering code to be jitted already (see PatternJitPipeline)
+
+  const JittedMapping &first = *job.mappings[first_mapping];
+  std::vector<PatternAddressMapper *> mappers;
+  for (size_t i = first_mapping; i < first_mapping + num_mappings; ++i) mappers.push_back(&job.mappings[i]->mapper);
+
+  std::vector<size_t> flipped_bits(num_mappings, 0);
+  for (size_t dram_location = 0; dram_location < program_args.num_dram_locations_per_mapping; ++dram_location) {
+    for (auto &mapper : mappers) mapper->bit_flips.emplace_back();
+
+    if (num_mappings==1) {
+      Logger::log_info(format_string("Running pattern #%lu (%s) for address set %d (%s) at DRAM location #%ld.",
+          pattern_no,
+          job.pattern.instance_id.c_str(),
+          first_mapping,
+          mappers.front()->get_instance_id().c_str(),
+          dram_location));
+    } else {
+      Logger::log_info(format_string("Running pattern #%lu (%s) for address sets %zu to %zu interleaved on %zu banks "
+                                     "at DRAM location #%ld.",
+          pattern_no,
+          job.pattern.instance_id.c_str(),
+          first_mapping,
+          first_mapping + num_mappings - 1,
+          num_mappings,
+          dram_location));
+    }
 
     // wait for a random time before starting to hammer, while waiting access random rows that are not part of the
     // currently hammering pattern; this wait interval serves for two purposes: to reset the sampler and start from a
     // clean state before hammering, and also to fuzz a possible dependence at which REF we start hammering
     auto wait_until_hammering_us = fuzzing_params.get_random_wait_until_start_hammering_us();
-    FuzzingParameterSet::print_dynamic_parameters2(sync_at_each_ref, wait_until_hammering_us, num_aggs_for_sync);
+    FuzzingParameterSet::print_dynamic_parameters2(first.sync_at_each_ref, wait_until_hammering_us,
+        first.num_aggs_for_sync);
 
     std::vector<volatile char *> random_rows;
     if (wait_until_hammering_us > 0) {
-      random_rows = mapper.get_random_nonaccessed_rows(fuzzing_params.get_max_row_no());
+      random_rows = mappers.front()->get_random_nonaccessed_rows(fuzzing_params.get_max_row_no());
       do_random_accesses(random_rows, wait_until_hammering_us);
     }
 
     // do hammering
     code_jitter.hammer_pattern(fuzzing_params, true);
+    // the timing trace of an interleaved run belongs to each of its mappings
+    for (auto &mapper : mappers) {
+      if (&mapper->get_code_jitter()!=&code_jitter) mapper->get_code_jitter().trace_stats = code_jitter.trace_stats;
+    }
 
-    // check if any bit flips happened
-    flipped_bits += memory.check_memory(mapper, false, true);
+    // check if any bit flips happened; interleaved mappings have their own victim rows on their own bank, i.e., a
+    // single run evaluates all of them
+    for (size_t i = 0; i < num_mappings; ++i) flipped_bits[i] += memory.check_memory(*mappers[i], false, true);
 
     // now shift the mapping to another location
     std::mt19937 gen = std::mt19937(std::random_device()());
-    mapper.shift_mapping(Range<int>(1,32).get_random_number(gen), {});
+    for (auto &mapper : mappers) mapper->shift_mapping(Range<int>(1,32).get_random_number(gen), {});
 
-    if (dram_location + 1 < num_dram_locations) {
+    if (dram_location + 1 < program_args.num_dram_locations_per_mapping) {
       // wait a bit and do some random accesses before checking reproducibility of the pattern
-      if (random_rows.empty()) random_rows = mapper.get_random_nonaccessed_rows(fuzzing_params.get_max_row_no());
+      if (random_rows.empty()) {
+        random_rows = mappers.front()->get_random_nonaccessed_rows(fuzzing_params.get_max_row_no());
+      }
       do_random_accesses(random_rows, 64000); // 64ms (retention time)
     }
   }
 
-  // store info about this bit flip (pattern ID, mapping ID, no. of bit flips)
-  map_pattern_mappings_bitflips[hammering_pattern.instance_id].emplace(mapper.get_instance_id(), flipped_bits);
-
   // cleanup the jitter for its next use
   code_jitter.cleanup();
+  return flipped_bits;
 }
 
 void FuzzyHammerer::log_overall_statistics(size_t cur_round, const std::string &best_mapping_id,
@@ -0,0 +1,203 @@
+#include "Forges/HammerWorkerPool.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <atomic>
+
+#include "GlobalDefines.hpp"
+#include "Memory/DRAMAddr.hpp"
+#include "Memory/Memory.hpp"
+#include "Utilities/AsmPrimitives.hpp"
+#include "Utilities/Logger.hpp"
+#include "Utilities/TimeHelper.hpp"
+
+namespace {
+
+void pin_thread(std::thread &thread, int cpu) {
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu, &cpuset);
+  pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuset);
+}
+
+}
+
+HammerWorkerPool::HammerWorkerPool(const std::vector<int> &cpus) : busy_banks(0), num_running(0), stopping(false) {
+  for (const auto &cpu : cpus) {
+    workers.emplace_back(&HammerWorkerPool::run, this);
+    pin_thread(workers.back(), cpu);
+  }
+  std::string cpu_list;
+  for (const auto &cpu : cpus) cpu_list += (cpu_list.empty() ? "" : ", ") + std::to_string(cpu);
+  Logger::log_info(format_string("Started %zu hammering threads on CPUs %s.", workers.size(), cpu_list.c_str()));
+}
+
+HammerWorkerPool::~HammerWorkerPool() {
+  wait_all();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  task_available.notify_all();
+  for (auto &worker : workers) {
+    if (worker.joinable()) worker.join();
+  }
+}
+
+void HammerWorkerPool::submit(Task task, const std::vector<int> &banks) {
+  uint64_t bank_mask = 0;
+  for (const auto &bank : banks) bank_mask |= (1ULL << static_cast<unsigned>(bank));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending_tasks.push_back({std::move(task), bank_mask});
+  }
+  task_available.notify_all();
+}
+
+void HammerWorkerPool::wait_for_idle_worker() {
+  std::unique_lock<std::mutex> lock(mutex);
+  task_finished.wait(lock, [this] { return pending_tasks.size() + num_running < workers.size(); });
+}
+
+void HammerWorkerPool::wait_all() {
+  std::unique_lock<std::mutex> lock(mutex);
+  task_finished.wait(lock, [this] { return pending_tasks.empty() && num_running==0; });
+}
+
+std::vector<std::string> HammerWorkerPool::take_logs() {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<std::string> logs;
+  logs.swap(finished_logs);
+  return logs;
+}
+
+size_t HammerWorkerPool::get_num_workers() const {
+  return workers.size();
+}
+
+void HammerWorkerPool::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    // take the oldest task that does not share a bank with any running task
+    auto next = pending_tasks.end();
+    task_available.wait(lock, [this, &next] {
+      next = std::find_if(pending_tasks.begin(), pending_tasks.end(),
+          [this](const PendingTask &t) { return (t.banks & busy_banks)==0; });
+      return stopping || next!=pending_tasks.end();
+    });
+    if (next==pending_tasks.end()) return;
+
+    PendingTask task = std::move(*next);
+    pending_tasks.erase(next);
+    busy_banks |= task.banks;
+    num_running++;
+    lock.unlock();
+
+    Logger::begin_capture();
+    task.task();
+    auto log = Logger::end_capture();
+
+    lock.lock();
+    busy_banks &= ~task.banks;
+    num_running--;
+    finished_logs.push_back(std::move(log));
+    // a bank became free, which may unblock a pending task
+    task_available.notify_all();
+    task_finished.notify_all();
+  }
+}
+
+std::vector<int> HammerWorkerPool::get_worker_cpus() {
+  // the pattern jitting thread uses the first and the ACTs per tREFI estimator the last other CPU of the NUMA node
+  auto cpus = Memory::get_numa_local_cpus();
+  const int cur_cpu = sched_getcpu();
+  cpus.erase(std::remove(cpus.begin(), cpus.end(), cur_cpu), cpus.end());
+  if (!cpus.empty()) cpus.erase(cpus.begin());
+  if (!cpus.empty()) cpus.pop_back();
+  return cpus;
+}
+
+std::pair<size_t, size_t> HammerWorkerPool::get_calibration_rows() {
+  const auto rows_per_superpage = DRAMAddr::get_num_rows_per_superpage();
+  return {rows_per_superpage/4, 3*rows_per_superpage/4};
+}
+
+double HammerWorkerPool::measure_acts_per_trefi(const std::vector<int> &cpus, size_t num_threads) {
+  // each thread alternates between two rows of its own bank, i.e., each access is an ACT
+  const size_t row_a = get_calibration_rows().first;
+  const size_t row_b = get_calibration_rows().second;
+  std::vector<double> acts_per_trefi(num_threads, 0);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&go, &acts_per_trefi, t, row_a, row_b]() {
+      auto a = (volatile char *) DRAMAddr(t, row_a, 0).to_virt();
+      auto b = (volatile char *) DRAMAddr(t, row_b, 0).to_virt();
+      while (!go.load(std::memory_order_acquire)) {}
+
+      const auto start_ts = get_timestamp_us();
+      const auto end_ts = start_ts + static_cast<int64_t>(CALIBRATION_DURATION_MS*1000);
+      uint64_t num_acts = 0;
+      int64_t now;
+      do {
+        for (size_t i = 0; i < 1000; ++i) {
+          clflushopt(a);
+          clflushopt(b);
+          mfence();
+          (void) *a;
+          (void) *b;
+        }
+        num_acts += 2000;
+        now = get_timestamp_us();
+      } while (now < end_ts);
+      const auto elapsed_ns = static_cast<double>(std::max<int64_t>(1, now - start_ts))*1000.0;
+      acts_per_trefi[t] = static_cast<double>(num_acts)/(elapsed_ns/TREFI_NS);
+    });
+    pin_thread(threads.back(), cpus[t]);
+  }
+  go.store(true, std::memory_order_release);
+  for (auto &thread : threads) thread.join();
+
+  double sum = 0;
+  for (const auto &rate : acts_per_trefi) sum += rate;
+  return sum/static_cast<double>(num_threads);
+}
+
+size_t HammerWorkerPool::calibrate_num_workers(const std::vector<int> &cpus, size_t max_workers, Memory &memory) {
+  // each thread needs a bank of its own
+  const size_t max_threads = std::min({max_workers, cpus.size(), static_cast<size_t>(NUM_BANKS)});
+  if (max_threads <= 1) return max_threads;
+
+  Logger::log_info("Calibrating the number of hammering threads:");
+  Logger::log_data(format_string("%8s  %20s  %14s", "#threads", "ACTs/tREFI/thread", "rel. probes/h"));
+  size_t best_num_threads = 1;
+  double best_throughput = 0;
+  double single_thread_rate = 0;
+  for (size_t n = 1; n <= max_threads; ++n) {
+    const double rate = measure_acts_per_trefi(cpus, n);
+    if (n==1) single_thread_rate = rate;
+    // a probe consists of a fixed number of ACTs, i.e., the probes per hour grow with the total ACT rate
+    const double throughput = static_cast<double>(n)*rate;
+    Logger::log_data(format_string("%8zu  %20.1f  %14.2f", n, rate,
+        (single_thread_rate > 0) ? throughput/single_thread_rate : 0.0));
+    if (throughput > best_throughput) {
+      best_throughput = throughput;
+      best_num_threads = n;
+    }
+  }
+
+  // the calibration rows of all banks lie in the same virtual address range as the row bits are the upper bits of an
+  // address within a superpage; we repair any bit flips caused by hammering them
+  size_t num_bitflips = 0;
+  for (const auto &row : {get_calibration_rows().first, get_calibration_rows().second}) {
+    num_bitflips += memory.check_memory((volatile char *) DRAMAddr(0, row - CALIBRATION_CHECK_ROWS, 0).to_virt(),
+        (volatile char *) DRAMAddr(0, row + CALIBRATION_CHECK_ROWS + 1, 0).to_virt());
+  }
+  if (num_bitflips > 0) {
+    Logger::log_info(format_string("Repaired %zu bit flips caused by the calibration.", num_bitflips));
+  }
+
+  Logger::log_info(format_string("Using %zu hammering threads.", best_num_threads));
+  return best_num_threads;
+}
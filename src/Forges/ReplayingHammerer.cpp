@@ -6,6 +6,7 @@
 #include <numeric>
 
 #include "Forges/FuzzyHammerer.hpp"
+#include "Fuzzer/JitCodeCache.hpp"
 
 #ifdef ENABLE_JSON
 #include <Blacksmith.hpp>
@@ -113,6 +114,10 @@ void ReplayingHammerer::replay_patterns(const std::string& json_filename,
   // mapping from mapping ID to repeatability data
   std::unordered_map<std::string,RepeatabilityData> repeatability_data;
 
+  // the memory is mapped at the same address as during fuzzing, i.e., the functions jitted for the patterns' mappings
+  // can be reused across replay runs
+  JitCodeCache::instance().open(JIT_CODE_CACHE_DIR, mem.get_starting_address(), CodeJitter::get_code_generator_id());
+
   // load all patterns from file
   auto loaded_patterns = load_patterns_from_json(json_filename, pattern_ids);
 
@@ -236,6 +241,7 @@ void ReplayingHammerer::replay_patterns(const std::string& json_filename,
     if (processed_patterns >= REPEATABILITY_MAX_NUM_PATTERNS) break;
 
   }  //   for (auto &patt : loaded_patterns)
+  JitCodeCache::instance().log_stats();
 #if 0
   // :::::::::::::::::::::::::::::::::::::::::::::::::::::
   // ::: BLIND SPOTS OF MITIGATION
@@ -562,8 +568,11 @@ void ReplayingHammerer::replay_patterns(const std::string& json_filename,
 size_t ReplayingHammerer::replay_patterns_brief(const std::string& json_filename,
                                                 const std::unordered_set<std::string> &pattern_ids, size_t sweep_bytes,
                                                 bool running_on_original_dimm) {
+  JitCodeCache::instance().open(JIT_CODE_CACHE_DIR, mem.get_starting_address(), CodeJitter::get_code_generator_id());
   auto patterns = load_patterns_from_json(json_filename, pattern_ids);
-  return replay_patterns_brief(patterns, sweep_bytes, 1, running_on_original_dimm);
+  const auto bitflips_count = replay_patterns_brief(patterns, sweep_bytes, 1, running_on_original_dimm);
+  JitCodeCache::instance().log_stats();
+  return bitflips_count;
 }
 
 size_t ReplayingHammerer::replay_patterns_brief(std::vector<HammeringPattern> hammering_patterns,
@@ -769,10 +778,21 @@ size_t ReplayingHammerer::hammer_pattern(FuzzingParameterSet &fuzz_params, CodeJ
   // load victims for memory check
   mapper.determine_victims(pattern.agg_access_patterns);
 
-  // create instructions that follow this pattern (i.e., do jitting of code)
+  // create instructions that follow this pattern (i.e., do jitting of code), unless the jitter holds a relocatable
+  // function (e.g., while sweeping) that only needs to be pointed to the new addresses
   auto const acts_per_tref = static_cast<int>(pattern.total_activations/pattern.num_refresh_intervals);
-  code_jitter.jit_strict(acts_per_tref, flushing_strategy, fencing_strategy, hammering_accesses_vec, sync_each_ref,
-      aggressors_for_sync, num_activations);
+  const bool relocatable = code_jitter.is_relocatable();
+  if (relocatable) {
+    if (!code_jitter.update_addresses(hammering_accesses_vec)) {
+      code_jitter.cleanup();
+      code_jitter.jit_relocatable(acts_per_tref, flushing_strategy, fencing_strategy, hammering_accesses_vec,
+          sync_each_ref, aggressors_for_sync, num_activations, pattern.base_period);
+      num_relocatable_rejits++;
+    }
+  } else {
+    code_jitter.jit_strict(acts_per_tref, flushing_strategy, fencing_strategy, hammering_accesses_vec, sync_each_ref,
+        aggressors_for_sync, num_activations, pattern.base_period);
+  }
 
   // dirty hack to get correct output of flipped rows as we need to aggregate the results over all tries
   std::vector<BitFlip> flipped_bits_acc;
@@ -813,7 +833,8 @@ size_t ReplayingHammerer::hammer_pattern(FuzzingParameterSet &fuzz_params, CodeJ
 
   mem.flipped_bits = std::move(flipped_bits_acc);
 
-  code_jitter.cleanup();
+  // a relocatable function is kept for the next call, the caller is responsible for cleaning it up
+  if (!relocatable) code_jitter.cleanup();
 
   return total_bitflips_all_reps;
 }
@@ -855,10 +876,30 @@ struct SweepSummary ReplayingHammerer::sweep_pattern(HammeringPattern &pattern,
   size_t total_bit_flips_sweeping = 0;
   std::vector<BitFlip> bflips;
   std::vector<BitFlip> bitflips_list;
+
+  // for the first rows, hammer_pattern jits the pattern for each row; afterwards, we jit the pattern once as
+  // relocatable code and hammer_pattern then only rewrites its address table for each row shift
+  const size_t num_rows_jitted_per_row = std::min<size_t>(num_sweep_rows_jitted_per_row, num_rows);
+  const auto sweep_start_ts = get_timestamp_us();
+  auto relocatable_start_ts = sweep_start_ts;
+  int64_t jit_duration_us = 0;
+  num_relocatable_rejits = 0;
+  jitter.cleanup();
+
   for (unsigned long r = 1; r <= num_rows; ++r) {
     // modify assignment of agg ID to DRAM address by shifting rows of all aggressors by 1
     mapper.shift_mapping(1, effective_aggs);
 
+    if (r==num_rows_jitted_per_row + 1) {
+      relocatable_start_ts = get_timestamp_us();
+      std::vector<volatile char *> accesses;
+      mapper.export_pattern(pattern.aggressors, pattern.base_period, accesses);
+      jitter.jit_relocatable(static_cast<int>(pattern.total_activations/pattern.num_refresh_intervals),
+          jitter.flushing_strategy, jitter.fencing_strategy, accesses, jitter.pattern_sync_each_ref,
+          jitter.num_aggs_for_sync, jitter.total_activations, pattern.base_period);
+      jit_duration_us = get_timestamp_us() - relocatable_start_ts;
+    }
+
     // call hammer_pattern
     auto num_flips = hammer_pattern(params, jitter, pattern, mapper, jitter.flushing_strategy,
         jitter.fencing_strategy, num_reps, jitter.num_aggs_for_sync, jitter.total_activations, true,
@@ -877,7 +918,25 @@ struct SweepSummary ReplayingHammerer::sweep_pattern(HammeringPattern &pattern,
     Logger::log_data(ss.str());
   }
 
+  jitter.cleanup();
+  const auto sweep_end_ts = get_timestamp_us();
+  if (num_rows_jitted_per_row==num_rows) relocatable_start_ts = sweep_end_ts;
+  auto rows_per_sec = [](size_t rows, int64_t duration_us) {
+    return static_cast<double>(rows)/(static_cast<double>(std::max<int64_t>(1, duration_us))/1e6);
+  };
+
   Logger::log_info("Summary of sweeping pattern:");
+  Logger::log_data(format_string("Swept %lu rows in %.2f s.", num_rows,
+      static_cast<double>(sweep_end_ts - sweep_start_ts)/1e6));
+  Logger::log_data(format_string("Jitting per row: %zu rows at %.2f rows/s.", num_rows_jitted_per_row,
+      rows_per_sec(num_rows_jitted_per_row, relocatable_start_ts - sweep_start_ts)));
+  if (num_rows > num_rows_jitted_per_row) {
+    Logger::log_data(format_string("Relocatable code: %lu rows at %.2f rows/s, jitted once in %.2f ms (re-jitted %zu "
+                                   "times as the address table could not be reused).",
+        num_rows - num_rows_jitted_per_row, rows_per_sec(num_rows - num_rows_jitted_per_row,
+            sweep_end_ts - relocatable_start_ts),
+        static_cast<double>(jit_duration_us)/1000.0, num_relocatable_rejits));
+  }
   Logger::log_data(format_string("Total corruptions: %ld", total_bit_flips_sweeping));
   size_t z2o_corruptions = 0;
   size_t o2z_corruptions = 0;
@@ -940,6 +999,33 @@ ReplayingHammerer::ReplayingHammerer(Memory &mem) : mem(mem) { /* NOLINT */
         (sync ? "true" : "false"), num_bit_flips));
   }
 
+  // - loop compression: compare the code size and the achieved ACTs per tREFI with the fully unrolled code
+  for (auto &loop_compression : {true, false}) {
+    cj.use_loop_compression = loop_compression;
+    auto num_bit_flips = hammer_pattern(params, cj, patt, mapper, cj.flushing_strategy, cj.fencing_strategy,
+        hammering_num_reps, cj.num_aggs_for_sync, cj.total_activations, false, cj.pattern_sync_each_ref, false, false,
+        false, true, true);
+    Logger::log_info(format_string("loop_compression = %-8s => %d bit flips (code size: %zu bytes, "
+                                   "ACTs per tREFI (est.): %.1f)", (loop_compression ? "true" : "false"),
+        num_bit_flips, cj.get_code_size(), cj.get_last_acts_per_trefi()));
+  }
+  cj.use_loop_compression = true;
+
+  // - backend: compare the ACTs per tREFI achieved by the jitted code with the ones achieved by the interpreter
+  const bool default_use_interpreter = CodeJitter::use_interpreter;
+  for (auto &interpret : {false, true}) {
+#ifndef ENABLE_JITTING
+    if (!interpret) continue;
+#endif
+    CodeJitter::use_interpreter = interpret;
+    auto num_bit_flips = hammer_pattern(params, cj, patt, mapper, cj.flushing_strategy, cj.fencing_strategy,
+        hammering_num_reps, cj.num_aggs_for_sync, cj.total_activations, false, cj.pattern_sync_each_ref, false, false,
+        false, true, true);
+    Logger::log_info(format_string("backend = %-12s => %d bit flips (ACTs per tREFI (est.): %.1f)",
+        (interpret ? "interpreter" : "jit"), num_bit_flips, cj.get_last_acts_per_trefi()));
+  }
+  CodeJitter::use_interpreter = default_use_interpreter;
+
   // - num_aggs_for_sync
   for (const auto &sync_aggs : {1, 2}) {
     auto num_bit_flips = hammer_pattern(params, cj, patt, mapper, cj.flushing_strategy, cj.fencing_strategy,
@@ -1060,7 +1146,7 @@ void ReplayingHammerer::find_direct_effective_aggs(PatternAddressMapper &mapper,
     auto max_row = params.get_max_row_no();
     auto offset = (mapper.max_row - lowest_row_no + Range<int>(1, 256).get_random_number(gen))%max_row;
     for (const auto &agg : agg_pair.aggressors) {
-      cur_mapping.at(agg.id).row += offset;
+      cur_mapping.at(agg.id).row = DRAMAddr::shift_row(cur_mapping.at(agg.id).row, static_cast<long>(offset));
     }
 
     // do jitting + hammering
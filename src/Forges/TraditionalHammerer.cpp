@@ -2,6 +2,7 @@
 
 #include "Utilities/TimeHelper.hpp"
 #include "Blacksmith.hpp"
+#include "Memory/RefTiming.hpp"
 
 /// Performs hammering on given aggressor rows for HAMMER_ROUNDS times.
 void TraditionalHammerer::hammer(std::vector<volatile char *> &aggressors) {
@@ -42,8 +43,8 @@ void TraditionalHammerer::hammer_sync(std::vector<volatile char *> &aggressors,
   (void)*d1;
   (void)*d2;
 
-  // synchronize with the beginning of an interval
-  while (true) {
+  // synchronize with the beginning of an interval, give up after MAX_SYNC_ROUNDS if we missed the REFRESH
+  for (size_t round = 0; round < MAX_SYNC_ROUNDS; ++round) {
     clflushopt(d1);
     clflushopt(d2);
     mfence();
@@ -53,7 +54,7 @@ void TraditionalHammerer::hammer_sync(std::vector<volatile char *> &aggressors,
     (void)*d2;
     after = rdtscp();
     // check if an ACTIVATE was issued
-    if ((after - before) > 1000) {
+    if (RefTiming::is_refresh(after - before)) {
       break;
     }
   }
@@ -69,7 +70,7 @@ void TraditionalHammerer::hammer_sync(std::vector<volatile char *> &aggressors,
     }
 
     // after HAMMER_ROUNDS/ref_rounds times hammering, check for next ACTIVATE
-    while (true) {
+    for (size_t round = 0; round < MAX_SYNC_ROUNDS; ++round) {
       mfence();
       lfence();
       before = rdtscp();
@@ -81,7 +82,7 @@ void TraditionalHammerer::hammer_sync(std::vector<volatile char *> &aggressors,
       after = rdtscp();
       lfence();
       // stop if an ACTIVATE was issued
-      if ((after - before) > 1000) break;
+      if (RefTiming::is_refresh(after - before)) break;
     }
   }
 }
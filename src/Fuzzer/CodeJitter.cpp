@@ -1,14 +1,80 @@
 #include "Fuzzer/CodeJitter.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+#include "GlobalDefines.hpp"
+#include "Fuzzer/JitCodeArena.hpp"
+#include "Fuzzer/JitCodeCache.hpp"
+#include "Memory/RefTiming.hpp"
+#include "Utilities/AsmPrimitives.hpp"
+#include "Utilities/TimeHelper.hpp"
+
+namespace {
+
+/// Returns the smallest multiple of base_period (that is also a multiple of alignment) with which the accesses in
+/// [first, check_end) repeat, i.e., accesses[i]==accesses[i+period], or 0 if the accesses in [first, end) do not repeat
+/// at least twice.
+int find_access_period(const std::vector<volatile char *> &accesses, int first, int end, int base_period,
+                       int alignment, int check_end) {
+  for (int period = base_period; 2*period <= end - first; period += base_period) {
+    if (period%alignment!=0) continue;
+    bool periodic = true;
+    for (int i = first; i + period < check_end && periodic; ++i) {
+      periodic = (accesses[i]==accesses[i + period]);
+    }
+    if (periodic) return period;
+  }
+  return 0;
+}
+
+}
+
 CodeJitter::CodeJitter()
-    : pattern_sync_each_ref(false),
+    : loop_body_accesses(0),
+      loop_iterations(0),
+      code_size(0),
+      last_acts_per_trefi(0),
+      num_register_aggressors(0),
+      num_interleaved_sequences(1),
+      use_loop_compression(true),
+      use_register_aggressors(true),
+      pattern_sync_each_ref(false),
       flushing_strategy(FLUSHING_STRATEGY::EARLIEST_POSSIBLE),
       fencing_strategy(FENCING_STRATEGY::LATEST_POSSIBLE),
+      access_strategy(ACCESS_STRATEGY::LOAD),
+      flush_instruction(get_supported_flush_instructions().front()),
       total_activations(5000000),
       num_aggs_for_sync(2) {
+}
+
 #ifdef ENABLE_JITTING
-  logger = new asmjit::StringLogger;
+bool CodeJitter::use_interpreter = false;
+#else
+bool CodeJitter::use_interpreter = true;
 #endif
+
+bool CodeJitter::use_timing_trace = false;
+
+CodeJitter::CodeJitter(const CodeJitter &other) : CodeJitter() {
+  *this = other;
+}
+
+CodeJitter &CodeJitter::operator=(const CodeJitter &other) {
+  if (this==&other) return *this;
+  cleanup();
+  use_loop_compression = other.use_loop_compression;
+  use_register_aggressors = other.use_register_aggressors;
+  pattern_sync_each_ref = other.pattern_sync_each_ref;
+  flushing_strategy = other.flushing_strategy;
+  fencing_strategy = other.fencing_strategy;
+  access_strategy = other.access_strategy;
+  flush_instruction = other.flush_instruction;
+  trace_stats = other.trace_stats;
+  total_activations = other.total_activations;
+  num_aggs_for_sync = other.num_aggs_for_sync;
+  return *this;
 }
 
 CodeJitter::~CodeJitter() {
@@ -18,23 +84,86 @@ CodeJitter::~CodeJitter() {
 void CodeJitter::cleanup() {
 #ifdef ENABLE_JITTING
   if (fn!=nullptr) {
-    runtime.release(fn);
+    JitCodeArena::instance().release((void *) fn);
     fn = nullptr;
   }
-  if (logger!=nullptr) {
-    delete logger;
-    logger = nullptr;
+  if (fn_relocatable!=nullptr) {
+    JitCodeArena::instance().release((void *) fn_relocatable);
+    fn_relocatable = nullptr;
   }
 #endif
+  interpreter.clear();
+  address_table.clear();
+  access_slots.clear();
+  slot_of_address.clear();
+#ifdef ENABLE_JITTING
+  register_of_address.clear();
+#endif
+}
+
+bool CodeJitter::is_relocatable() const {
+  return fn_relocatable!=nullptr || (interpreter.is_prepared() && !access_slots.empty());
+}
+
+size_t CodeJitter::get_code_size() const {
+  return code_size;
+}
+
+double CodeJitter::get_last_acts_per_trefi() const {
+  return last_acts_per_trefi;
+}
+
+size_t CodeJitter::get_num_interleaved_sequences() const {
+  return num_interleaved_sequences;
+}
+
+bool CodeJitter::update_addresses(const std::vector<volatile char *> &aggressor_pairs) {
+  if (!is_relocatable() || aggressor_pairs.size()!=access_slots.size()) return false;
+
+  // the new sequence must access the same slot at the same positions, otherwise two aggressors that were distinct when
+  // jitting could now be the same (or vice versa) and the jitted flushes/fences would not match anymore
+  std::vector<volatile char *> new_table(address_table.size(), nullptr);
+  for (size_t i = 0; i < aggressor_pairs.size(); ++i) {
+    auto &slot = new_table[access_slots[i]];
+    if (slot==nullptr) {
+      slot = aggressor_pairs[i];
+    } else if (slot!=aggressor_pairs[i]) {
+      return false;
+    }
+  }
+  std::unordered_map<volatile char *, size_t> distinct;
+  for (size_t i = 0; i < new_table.size(); ++i) {
+    if (!distinct.emplace(new_table[i], i).second) return false;
+  }
+  address_table = std::move(new_table);
+  if (interpreter.is_prepared()) interpreter.set_addresses(aggressor_pairs);
+  return true;
 }
 
 int CodeJitter::hammer_pattern(FuzzingParameterSet &fuzzing_parameters, bool verbose) {
-  if (fn==nullptr) {
+  if (fn==nullptr && fn_relocatable==nullptr && !interpreter.is_prepared()) {
     Logger::log_error("Skipping hammering pattern as pattern could not be created successfully.");
     return -1;
   }
   if (verbose) Logger::log_info("Hammering the last generated pattern.");
-  int total_sync_acts = fn();
+  if (trace!=nullptr) trace->reset();
+  const auto start_tsc = rdtscp();
+  const auto start_ts = get_timestamp_us();
+  int total_sync_acts;
+  if (fn_relocatable!=nullptr) {
+    total_sync_acts = fn_relocatable(address_table.data());
+  } else if (fn!=nullptr) {
+    total_sync_acts = fn();
+  } else {
+    total_sync_acts = interpreter.hammer();
+  }
+  const auto elapsed_us = std::max<int64_t>(1, get_timestamp_us() - start_ts);
+  const auto elapsed_tsc = rdtscp() - start_tsc;
+  if (trace!=nullptr) {
+    trace_stats = trace->analyze(static_cast<double>(elapsed_tsc)/(static_cast<double>(elapsed_us)*1000.0));
+  }
+  // this includes the time spent for synchronization, hence it is a lower bound of the achieved rate
+  last_acts_per_trefi = static_cast<double>(total_activations)/(static_cast<double>(elapsed_us)*1000.0/TREFI_NS);
 
   if (verbose) {
     Logger::log_info("Synchronization stats:");
@@ -53,6 +182,25 @@ int CodeJitter::hammer_pattern(FuzzingParameterSet &fuzzing_parameters, bool ver
     Logger::log_data(format_string("Number of pattern reps while hammering: %d", pattern_rounds));
     Logger::log_data(format_string("Number of total synced REFs (est.): %d", num_synced_refs));
     Logger::log_data(format_string("Avg. number of acts per sync: %d", total_sync_acts/num_synced_refs));
+    Logger::log_data(format_string("Achieved ACTs per tREFI (est.): %.1f", last_acts_per_trefi));
+    if (interpreter.is_prepared()) {
+      Logger::log_data("Backend: interpreter");
+    } else if (loop_iterations > 0) {
+      Logger::log_data(format_string("Code size: %zu bytes (loop of %d accesses x %d iterations)",
+          code_size, loop_body_accesses, loop_iterations));
+    } else {
+      Logger::log_data(format_string("Code size: %zu bytes (unrolled)", code_size));
+    }
+    Logger::log_data(format_string("Register-resident aggressors: %zu", num_register_aggressors));
+    if (trace!=nullptr) {
+      Logger::log_data(format_string("Timing trace: %zu syncs, %.1f ACTs per tREFI, REF jitter %.0f ns, "
+                                     "%.0f cycles per sync",
+          trace_stats.num_syncs, trace_stats.acts_per_trefi, trace_stats.ref_jitter_ns, trace_stats.sync_cycles));
+    }
+    if (num_interleaved_sequences > 1) {
+      Logger::log_data(format_string("Interleaved access sequences: %zu (%.1f ACTs per tREFI per bank)",
+          num_interleaved_sequences, last_acts_per_trefi/static_cast<double>(num_interleaved_sequences)));
+    }
   }
 
   return total_sync_acts;
@@ -64,7 +212,74 @@ void CodeJitter::jit_strict(int num_acts_per_trefi,
                             const std::vector<volatile char *> &aggressor_pairs,
                             bool sync_each_ref,
                             int num_aggressors_for_sync,
-                            int total_num_activations) {
+                            int total_num_activations,
+                            int base_period) {
+  num_interleaved_sequences = 1;
+  jit_internal(num_acts_per_trefi, flushing, fencing, aggressor_pairs, sync_each_ref, num_aggressors_for_sync,
+      total_num_activations, base_period, false);
+}
+
+void CodeJitter::jit_relocatable(int num_acts_per_trefi,
+                                 FLUSHING_STRATEGY flushing,
+                                 FENCING_STRATEGY fencing,
+                                 const std::vector<volatile char *> &aggressor_pairs,
+                                 bool sync_each_ref,
+                                 int num_aggressors_for_sync,
+                                 int total_num_activations,
+                                 int base_period) {
+  num_interleaved_sequences = 1;
+  jit_internal(num_acts_per_trefi, flushing, fencing, aggressor_pairs, sync_each_ref, num_aggressors_for_sync,
+      total_num_activations, base_period, true);
+}
+
+void CodeJitter::jit_interleaved(int num_acts_per_trefi,
+                                 FLUSHING_STRATEGY flushing,
+                                 FENCING_STRATEGY fencing,
+                                 const std::vector<std::vector<volatile char *>> &aggressor_sequences,
+                                 bool sync_each_ref,
+                                 int num_aggressors_for_sync,
+                                 int total_num_activations,
+                                 int base_period) {
+  if (aggressor_sequences.empty()) {
+    Logger::log_error("Cannot jit an interleaved function for zero access sequences.");
+    return;
+  }
+
+  // merge the sequences round-robin: (a0, b0, c0, a1, b1, c1, ...), longer sequences continue on their own at the end
+  size_t max_length = 0;
+  size_t total_length = 0;
+  for (const auto &seq : aggressor_sequences) {
+    max_length = std::max(max_length, seq.size());
+    total_length += seq.size();
+  }
+  std::vector<volatile char *> interleaved_accesses;
+  interleaved_accesses.reserve(total_length);
+  for (size_t i = 0; i < max_length; ++i) {
+    for (const auto &seq : aggressor_sequences) {
+      if (i < seq.size()) interleaved_accesses.push_back(seq[i]);
+    }
+  }
+
+  // if all sequences are periodic with base_period, the merged sequence is periodic with K*base_period; this does not
+  // hold anymore if the sequences have different lengths, then we do not compress loops
+  const auto num_sequences = static_cast<int>(aggressor_sequences.size());
+  const bool same_length = std::all_of(aggressor_sequences.begin(), aggressor_sequences.end(),
+      [max_length](const std::vector<volatile char *> &seq) { return seq.size()==max_length; });
+
+  num_interleaved_sequences = aggressor_sequences.size();
+  jit_internal(num_acts_per_trefi*num_sequences, flushing, fencing, interleaved_accesses, sync_each_ref,
+      num_aggressors_for_sync, total_num_activations*num_sequences, same_length ? base_period*num_sequences : 0, false);
+}
+
+void CodeJitter::jit_internal(int num_acts_per_trefi,
+                              FLUSHING_STRATEGY flushing,
+                              FENCING_STRATEGY fencing,
+                              const std::vector<volatile char *> &aggressor_pairs,
+                              bool sync_each_ref,
+                              int num_aggressors_for_sync,
+                              int total_num_activations,
+                              int base_period,
+                              bool relocatable) {
 
   // this is used by hammer_pattern but only for some stats calculations
   this->pattern_sync_each_ref = sync_each_ref;
@@ -73,6 +288,20 @@ void CodeJitter::jit_strict(int num_acts_per_trefi,
   this->total_activations = total_num_activations;
   this->num_aggs_for_sync = num_aggressors_for_sync;
 
+  // the parameters may stem from a JSON file that was created on another machine
+  const auto &access_strategies = get_supported_access_strategies();
+  if (std::find(access_strategies.begin(), access_strategies.end(), access_strategy)==access_strategies.end()) {
+    Logger::log_error(format_string("Access strategy %s is not supported by this CPU, using %s instead.",
+        to_string(access_strategy).c_str(), to_string(ACCESS_STRATEGY::LOAD).c_str()));
+    access_strategy = ACCESS_STRATEGY::LOAD;
+  }
+  const auto &flush_instructions = get_supported_flush_instructions();
+  if (std::find(flush_instructions.begin(), flush_instructions.end(), flush_instruction)==flush_instructions.end()) {
+    Logger::log_error(format_string("Flush instruction %s is not supported by this CPU, using %s instead.",
+        to_string(flush_instruction).c_str(), to_string(flush_instructions.front()).c_str()));
+    flush_instruction = flush_instructions.front();
+  }
+
   // decides the number of aggressors of the beginning/end to be used for detecting the refresh interval
   // e.g., 10 means use the first 10 aggs in aggressor_pairs (repeatedly, if necessary) to detect the start refresh
   // (i.e., at the beginning) and the last 10 aggs in aggressor_pairs to detect the last refresh (at the end);
@@ -88,16 +317,76 @@ void CodeJitter::jit_strict(int num_acts_per_trefi,
   }
 
   // some sanity checks
-  if (fn!=nullptr) {
+  if (fn!=nullptr || fn_relocatable!=nullptr || interpreter.is_prepared()) {
     Logger::log_error(
         "Function pointer is not NULL, cannot continue jitting code without leaking memory. Did you forget to call cleanup() before?");
     exit(1);
   }
 
+  // assign each distinct address a slot in the address table, the relocatable function receives the table in rdi
+  address_table.clear();
+  access_slots.clear();
+  slot_of_address.clear();
+  if (relocatable) {
+    for (const auto &addr : aggressor_pairs) {
+      auto it = slot_of_address.emplace((uint64_t) addr, address_table.size()).first;
+      if (it->second==address_table.size()) address_table.push_back(addr);
+      access_slots.push_back(it->second);
+    }
+  }
+
+  // the trace buffer is kept across jitted functions as allocating it is expensive
+  if (use_timing_trace && trace==nullptr) {
+    trace = std::make_unique<TimingTrace>();
+  } else if (!use_timing_trace) {
+    trace.reset();
+  }
+  trace_stats = TimingTraceStats();
+  // the interpreter writes into the same trace (or none if it was reset)
+  interpreter.set_trace(trace.get());
+
+  // without code generation, the accesses are executed by the interpreter, which is relocatable anyway
+  if (use_interpreter) {
+    slot_of_address.clear();
+    loop_body_accesses = 0;
+    loop_iterations = 0;
+    code_size = 0;
+    num_register_aggressors = 0;
+    interpreter.prepare(num_acts_per_trefi, flushing, fencing, access_strategy, flush_instruction, aggressor_pairs,
+        sync_each_ref, num_aggressors_for_sync, total_num_activations, num_interleaved_sequences);
+    return;
+  }
+
 #ifdef ENABLE_JITTING
+
+  // a function with embedded addresses only depends on the accesses and parameters, hence it can be restored from the
+  // code cache instead of being generated; this does not hold if the function writes into this run's timing trace
+  const bool use_code_cache = !relocatable && trace==nullptr && JitCodeCache::instance().is_open();
+  uint64_t code_cache_key = 0;
+  if (use_code_cache) {
+    code_cache_key = get_code_cache_key(num_acts_per_trefi, aggressor_pairs, sync_each_ref, base_period);
+    JitCodeCache::Entry entry;
+    if (JitCodeCache::instance().load(code_cache_key, aggressor_pairs.size(), entry)) {
+      void *code_ptr = JitCodeArena::instance().allocate(entry.code.size());
+      if (code_ptr==nullptr) throw std::runtime_error("[-] Jitted code arena is full. Aborting execution!");
+      std::memcpy(code_ptr, entry.code.data(), entry.code.size());
+      slot_of_address.clear();
+      code_size = entry.code.size();
+      loop_body_accesses = entry.loop_body_accesses;
+      loop_iterations = entry.loop_iterations;
+      num_register_aggressors = entry.num_register_aggressors;
+      fn = reinterpret_cast<int (*)()>(code_ptr);
+      return;
+    }
+  }
+
   asmjit::CodeHolder code;
-  code.init(runtime.environment());
-  code.setLogger(logger);
+  code.init(asmjit::Environment::host());
+#ifdef DEBUG
+  // keeps track of the generated ASM instructions - useful for debugging
+  asmjit::StringLogger asm_logger;
+  code.setLogger(&asm_logger);
+#endif
   asmjit::x86::Assembler a(&code);
 
   asmjit::Label while1_begin = a.newLabel();
@@ -108,19 +397,56 @@ void CodeJitter::jit_strict(int num_acts_per_trefi,
   // ==== here start's the actual program ====================================================
   // The following JIT instructions are based on hammer_sync in blacksmith.cpp, git commit 624a6492.
 
+  // if the pattern has few enough distinct aggressors, keep their addresses in registers for the whole function such
+  // that flushes and loads can use them directly instead of materializing the address before each access
+  register_of_address.clear();
+  std::vector<asmjit::x86::Gp> saved_registers;
+  if (use_register_aggressors) {
+    std::vector<volatile char *> distinct_addresses;
+    std::unordered_map<uint64_t, bool> seen;
+    for (const auto &addr : aggressor_pairs) {
+      if (!seen[(uint64_t) addr]) distinct_addresses.push_back(addr);
+      seen[(uint64_t) addr] = true;
+    }
+    // rdi holds the address table of a relocatable function, hence it must be the last register that we load
+    // the remaining registers are used by rdtscp, for timestamps, and as counters; callee-saved registers must be
+    // restored before returning
+    const std::pair<asmjit::x86::Gp, bool> free_registers[] = {{asmjit::x86::r9, false}, {asmjit::x86::r10, false},
+        {asmjit::x86::r11, false}, {asmjit::x86::r12, true}, {asmjit::x86::r13, true}, {asmjit::x86::r14, true},
+        {asmjit::x86::r15, true}, {asmjit::x86::rbp, true}, {asmjit::x86::rdi, false}};
+    if (distinct_addresses.size() <= sizeof(free_registers)/sizeof(free_registers[0])) {
+      for (size_t i = 0; i < distinct_addresses.size(); ++i) {
+        const auto &[reg, callee_saved] = free_registers[i];
+        if (callee_saved) {
+          a.push(reg);
+          saved_registers.push_back(reg);
+        }
+        emit_load_address(a, reg, distinct_addresses[i]);
+      }
+      for (size_t i = 0; i < distinct_addresses.size(); ++i) {
+        register_of_address.emplace((uint64_t) distinct_addresses[i], free_registers[i].first);
+      }
+    }
+  }
+  num_register_aggressors = register_of_address.size();
+
   // ------- part 1: synchronize with the beginning of an interval ---------------------------
+  const auto evicting_flush = flush_instructions.front();
 
   // warmup
   for (int idx = 0; idx < NUM_TIMED_ACCESSES; idx++) {
-    a.mov(asmjit::x86::rax, (uint64_t) aggressor_pairs[idx]);
-    a.mov(asmjit::x86::rbx, asmjit::x86::ptr(asmjit::x86::rax));
+    a.mov(asmjit::x86::rbx, emit_address_operand(a, aggressor_pairs[idx]));
   }
 
+  // bound the number of synchronization rounds such that a missed REFRESH cannot stall the hammering forever; the
+  // remaining rounds are kept on the stack as all registers are in use
+  a.mov(asmjit::x86::rax, (uint64_t) MAX_SYNC_ROUNDS);
+  a.push(asmjit::x86::rax);
+
   a.bind(while1_begin);
-  // clflushopt addresses involved in sync
+  // flush addresses involved in sync
   for (int idx = 0; idx < NUM_TIMED_ACCESSES; idx++) {
-    a.mov(asmjit::x86::rax, (uint64_t) aggressor_pairs[idx]);
-    a.clflushopt(asmjit::x86::ptr(asmjit::x86::rax));
+    emit_flush(a, aggressor_pairs[idx], evicting_flush);
   }
   a.mfence();
 
@@ -131,19 +457,20 @@ void CodeJitter::jit_strict(int num_acts_per_trefi,
 
   // use first NUM_TIMED_ACCESSES addresses for sync
   for (int idx = 0; idx < NUM_TIMED_ACCESSES; idx++) {
-    a.mov(asmjit::x86::rax, (uint64_t) aggressor_pairs[idx]);
-    a.mov(asmjit::x86::rcx, asmjit::x86::ptr(asmjit::x86::rax));
+    a.mov(asmjit::x86::rcx, emit_address_operand(a, aggressor_pairs[idx]));
   }
 
-  // if ((after - before) > 1000) break;
+  // if ((after - before) > ref_threshold) break;
   a.rdtscp();  // result: edx:eax
   a.sub(asmjit::x86::eax, asmjit::x86::ebx);
-  a.cmp(asmjit::x86::eax, (uint64_t) 1000);
+  a.cmp(asmjit::x86::eax, RefTiming::get_threshold());
 
-  // depending on the cmp's outcome, jump out of loop or to the loop's beginning
+  // depending on the cmp's outcome, jump out of loop or to the loop's beginning unless we ran out of rounds
   a.jg(while1_end);
-  a.jmp(while1_begin);
+  a.dec(asmjit::x86::qword_ptr(asmjit::x86::rsp));
+  a.jnz(while1_begin);
   a.bind(while1_end);
+  a.add(asmjit::x86::rsp, 8);
 
   // ------- part 2: perform hammering ---------------------------------------------------------------------------------
 
@@ -160,35 +487,52 @@ void CodeJitter::jit_strict(int num_acts_per_trefi,
 
   size_t cnt_total_activations = 0;
 
-  // hammer each aggressor once
-  for (int i = NUM_TIMED_ACCESSES; i < static_cast<int>(aggressor_pairs.size()) - NUM_TIMED_ACCESSES; i++) {
+  // the interleaved accesses consist of rounds of one access to each of the K banks: instead of flushing and fencing
+  // before each access, which would serialize the banks again, we flush the round's aggressors and fence once before
+  // the round such that its K accesses can be served in parallel
+  const auto round_length = static_cast<int>(num_interleaved_sequences);
+  auto begin_round = [&](int i, bool emit) {
+    bool needs_fence = false;
+    const int round_end = std::min(i + round_length, static_cast<int>(aggressor_pairs.size()) - NUM_TIMED_ACCESSES);
+    for (int j = i; j < round_end; ++j) {
+      if (!accessed_before[(uint64_t) aggressor_pairs[j]]) continue;
+      if (emit && flushing==FLUSHING_STRATEGY::LATEST_POSSIBLE) emit_flush(a, aggressor_pairs[j], flush_instruction);
+      needs_fence = true;
+    }
+    if (emit && needs_fence && fencing==FENCING_STRATEGY::LATEST_POSSIBLE) a.mfence();
+  };
+
+  // emits the instructions for the i-th access of the pattern; if emit is false, only the bookkeeping is done, which
+  // we use to bring accessed_before into the state it has when entering a loop body for the second time
+  auto hammer_access = [&](int i, bool emit, bool count_in_rsi) {
     auto cur_addr = (uint64_t) aggressor_pairs[i];
+    auto cur_ptr = aggressor_pairs[i];
 
-    if (accessed_before[cur_addr]) {
+    if (round_length > 1) {
+      if (i%round_length==0) begin_round(i, emit);
+    } else if (accessed_before[cur_addr]) {
       // flush
       if (flushing==FLUSHING_STRATEGY::LATEST_POSSIBLE) {
-        a.mov(asmjit::x86::rax, cur_addr);
-        a.clflushopt(asmjit::x86::ptr(asmjit::x86::rax));
+        if (emit) emit_flush(a, cur_ptr, flush_instruction);
         accessed_before[cur_addr] = false;
       }
       // fence to ensure flushing finished and defined order of aggressors is guaranteed
       if (fencing==FENCING_STRATEGY::LATEST_POSSIBLE) {
-        a.mfence();
+        if (emit) a.mfence();
         accessed_before[cur_addr] = false;
       }
     }
+    accessed_before[cur_addr] = true;
+    if (!emit) return;
 
     // hammer
-    a.mov(asmjit::x86::rax, cur_addr);
-    a.mov(asmjit::x86::rcx, asmjit::x86::ptr(asmjit::x86::rax));
-    accessed_before[cur_addr] = true;
-    a.dec(asmjit::x86::rsi);
+    emit_access(a, cur_ptr);
+    if (count_in_rsi) a.dec(asmjit::x86::rsi);
     cnt_total_activations++;
 
     // flush
     if (flushing==FLUSHING_STRATEGY::EARLIEST_POSSIBLE) {
-      a.mov(asmjit::x86::rax, cur_addr);
-      a.clflushopt(asmjit::x86::ptr(asmjit::x86::rax));
+      emit_flush(a, cur_ptr, flush_instruction);
     }
     if (sync_each_ref
         && ((cnt_total_activations%num_acts_per_trefi)==0)) {
@@ -196,8 +540,38 @@ void CodeJitter::jit_strict(int num_acts_per_trefi,
           std::min(aggressor_pairs.begin() + i + NUM_TIMED_ACCESSES, aggressor_pairs.end()));
       sync_ref(aggs, a);
     }
+  };
+
+  // patterns consist of base periods that repeat with the aggressors' frequencies: instead of unrolling all accesses,
+  // we emit the accesses of one period of the pattern as loop body, followed by the remaining accesses
+  const int first_access = NUM_TIMED_ACCESSES;
+  const int end_access = static_cast<int>(aggressor_pairs.size()) - NUM_TIMED_ACCESSES;
+  loop_body_accesses = 0;
+  loop_iterations = 0;
+  if (use_loop_compression && base_period > 0) {
+    loop_body_accesses = find_access_period(aggressor_pairs, first_access, end_access, base_period,
+        sync_each_ref ? num_acts_per_trefi : 1, sync_each_ref ? static_cast<int>(aggressor_pairs.size()) : end_access);
+    loop_iterations = (loop_body_accesses > 0) ? (end_access - first_access)/loop_body_accesses : 0;
+    if (loop_iterations < 2) loop_body_accesses = loop_iterations = 0;
+  }
+
+  int next_access = first_access;
+  if (loop_iterations > 0) {
+    asmjit::Label loop_begin = a.newLabel();
+    for (int i = first_access; i < first_access + loop_body_accesses; i++) hammer_access(i, false, false);
+    a.mov(asmjit::x86::r8, loop_iterations);
+    a.bind(loop_begin);
+    for (int i = first_access; i < first_access + loop_body_accesses; i++) hammer_access(i, true, false);
+    a.sub(asmjit::x86::rsi, loop_body_accesses);
+    a.dec(asmjit::x86::r8);
+    a.jnz(loop_begin);
+    cnt_total_activations = static_cast<size_t>(loop_iterations)*static_cast<size_t>(loop_body_accesses);
+    next_access = first_access + loop_iterations*loop_body_accesses;
   }
 
+  // hammer each (remaining) aggressor once
+  for (int i = next_access; i < end_access; i++) hammer_access(i, true, true);
+
   // fences -> ensure that aggressors are not interleaved, i.e., we access aggressors always in same order
   a.mfence();
 
@@ -210,25 +584,132 @@ void CodeJitter::jit_strict(int num_acts_per_trefi,
 
   // now move our counter for no. of activations in the end of interval sync. to the 1st output register %eax
   a.mov(asmjit::x86::eax, asmjit::x86::edx);
+  for (auto it = saved_registers.rbegin(); it!=saved_registers.rend(); ++it) a.pop(*it);
   a.ret();  // this is ESSENTIAL otherwise execution of jitted code creates a segfault
 
-  // add the generated code to the runtime.
-  asmjit::Error err = runtime.add(&fn, &code);
-  if (err) throw std::runtime_error("[-] Error occurred while jitting code. Aborting execution!");
+  // copy the generated code into the code arena shared by all CodeJitter instances
+  slot_of_address.clear();
+  register_of_address.clear();
+  code.flatten();
+  code.resolveUnresolvedLinks();
+  code_size = code.codeSize();
+  void *code_ptr = JitCodeArena::instance().allocate(code_size);
+  if (code_ptr==nullptr) throw std::runtime_error("[-] Jitted code arena is full. Aborting execution!");
+  if (code.relocateToBase((uint64_t) code_ptr) || code.copyFlattenedData(code_ptr, code_size)) {
+    JitCodeArena::instance().release(code_ptr);
+    throw std::runtime_error("[-] Error occurred while jitting code. Aborting execution!");
+  }
+  if (relocatable) {
+    fn_relocatable = reinterpret_cast<int (*)(volatile char *const *)>(code_ptr);
+  } else {
+    fn = reinterpret_cast<int (*)()>(code_ptr);
+  }
+  if (use_code_cache) {
+    JitCodeCache::Entry entry;
+    entry.code.assign(static_cast<uint8_t *>(code_ptr), static_cast<uint8_t *>(code_ptr) + code_size);
+    entry.loop_body_accesses = loop_body_accesses;
+    entry.loop_iterations = loop_iterations;
+    entry.num_register_aggressors = num_register_aggressors;
+    JitCodeCache::instance().store(code_cache_key, aggressor_pairs.size(), entry);
+  }
 
-  // uncomment the following line to see the jitted ASM code
-  // printf("[DEBUG] asmjit logger content:\n%s\n", logger->corrupted_data());
+#ifdef DEBUG
+  Logger::log_debug(format_string("asmjit logger content:\n%s", asm_logger.data()));
+#endif
 #endif
 #ifndef ENABLE_JITTING
-  Logger::log_error("Cannot do code jitting. Set option ENABLE_JITTING to ON in CMakeLists.txt and do a rebuild.");
+  // this is just to ignore complaints of the compiler about unused params
+  std::ignore = base_period;
+  Logger::log_error("Cannot do code jitting. Set option ENABLE_JITTING to ON in CMakeLists.txt and do a rebuild, or "
+                    "use the interpreter instead.");
 #endif
 }
 
+uint64_t CodeJitter::get_code_generator_id() {
+  // the build time of this file, which contains the code generator, also covers changes to the headers it includes
+  const char build_time[] = __DATE__ " " __TIME__;
+  return JitCodeCache::hash(build_time, sizeof(build_time));
+}
+
 #ifdef ENABLE_JITTING
+uint64_t CodeJitter::get_code_cache_key(int num_acts_per_trefi, const std::vector<volatile char *> &aggressor_pairs,
+                                        bool sync_each_ref, int base_period) const {
+  // everything that influences the generated code, including the CPU-dependent flush used for synchronization
+  const int64_t params[] = {num_acts_per_trefi, static_cast<int64_t>(flushing_strategy),
+                            static_cast<int64_t>(fencing_strategy), static_cast<int64_t>(access_strategy),
+                            static_cast<int64_t>(flush_instruction),
+                            static_cast<int64_t>(get_supported_flush_instructions().front()), sync_each_ref,
+                            num_aggs_for_sync, total_activations, base_period, use_loop_compression,
+                            use_register_aggressors, static_cast<int64_t>(RefTiming::get_threshold()),
+                            MAX_SYNC_ROUNDS, static_cast<int64_t>(num_interleaved_sequences)};
+  const auto key = JitCodeCache::hash(aggressor_pairs.data(), aggressor_pairs.size()*sizeof(volatile char *));
+  return JitCodeCache::hash(params, sizeof(params), key);
+}
+
+void CodeJitter::emit_load_address(asmjit::x86::Assembler &assembler, const asmjit::x86::Gp &reg,
+                                   volatile char *addr) {
+  if (slot_of_address.empty()) {
+    assembler.mov(reg, (uint64_t) addr);
+  } else {
+    assembler.mov(reg, asmjit::x86::qword_ptr(asmjit::x86::rdi,
+        static_cast<int32_t>(slot_of_address.at((uint64_t) addr)*sizeof(volatile char *))));
+  }
+}
+
+asmjit::x86::Mem CodeJitter::emit_address_operand(asmjit::x86::Assembler &assembler, volatile char *addr) {
+  auto it = register_of_address.find((uint64_t) addr);
+  if (it!=register_of_address.end()) return asmjit::x86::ptr(it->second);
+  emit_load_address(assembler, asmjit::x86::rax, addr);
+  return asmjit::x86::ptr(asmjit::x86::rax);
+}
+
+void CodeJitter::emit_access(asmjit::x86::Assembler &assembler, volatile char *addr) {
+  auto mem = emit_address_operand(assembler, addr);
+  switch (access_strategy) {
+    case ACCESS_STRATEGY::NONTEMPORAL_LOAD:
+      assembler.movntdqa(asmjit::x86::xmm0, mem);
+      break;
+    case ACCESS_STRATEGY::PREFETCHNTA:
+      assembler.prefetchnta(mem);
+      break;
+    case ACCESS_STRATEGY::STORE:
+      // adding zero makes the line dirty without changing the data, i.e., the memory checks remain valid
+      mem.setSize(8);
+      assembler.add(mem, 0);
+      break;
+    case ACCESS_STRATEGY::LOAD:
+    default:
+      assembler.mov(asmjit::x86::rcx, mem);
+      break;
+  }
+}
+
+void CodeJitter::emit_flush(asmjit::x86::Assembler &assembler, volatile char *addr, FLUSH_INSTRUCTION instruction) {
+  auto mem = emit_address_operand(assembler, addr);
+  switch (instruction) {
+    case FLUSH_INSTRUCTION::CLFLUSH:
+      assembler.clflush(mem);
+      break;
+    case FLUSH_INSTRUCTION::CLWB:
+      assembler.clwb(mem);
+      break;
+    case FLUSH_INSTRUCTION::CLFLUSHOPT:
+    default:
+      assembler.clflushopt(mem);
+      break;
+  }
+}
+
 void CodeJitter::sync_ref(const std::vector<volatile char *> &aggressor_pairs, asmjit::x86::Assembler &assembler) {
   asmjit::Label wbegin = assembler.newLabel();
   asmjit::Label wend = assembler.newLabel();
 
+  if (trace!=nullptr) emit_trace_record(assembler, false);
+
+  // the remaining rounds, see part 1 of jit_internal
+  assembler.mov(asmjit::x86::rax, (uint64_t) MAX_SYNC_ROUNDS);
+  assembler.push(asmjit::x86::rax);
+
   assembler.bind(wbegin);
 
   assembler.mfence();
@@ -243,12 +724,10 @@ void CodeJitter::sync_ref(const std::vector<volatile char *> &aggressor_pairs, a
 
   for (auto agg : aggressor_pairs) {
     // flush
-    assembler.mov(asmjit::x86::rax, (uint64_t) agg);
-    assembler.clflushopt(asmjit::x86::ptr(asmjit::x86::rax));
+    emit_flush(assembler, agg, get_supported_flush_instructions().front());
 
     // access
-    assembler.mov(asmjit::x86::rax, (uint64_t) agg);
-    assembler.mov(asmjit::x86::rcx, asmjit::x86::ptr(asmjit::x86::rax));
+    assembler.mov(asmjit::x86::rcx, emit_address_operand(assembler, agg));
 
     // we do not deduct the sync aggressors from the total number of activations because the number of sync activations
     // varies for different patterns; if we deduct it from the total number of activations, we cannot ensure anymore
@@ -264,14 +743,47 @@ void CodeJitter::sync_ref(const std::vector<volatile char *> &aggressor_pairs, a
   assembler.lfence();
   assembler.pop(asmjit::x86::edx);
 
-  // if ((after - before) > 1000) break;
+  // if ((after - before) > ref_threshold) break;
   assembler.sub(asmjit::x86::eax, asmjit::x86::ebx);
-  assembler.cmp(asmjit::x86::eax, (uint64_t) 1000);
+  assembler.cmp(asmjit::x86::eax, RefTiming::get_threshold());
 
   // depending on the cmp's outcome...
-  assembler.jg(wend);     // ... jump out of the loop
-  assembler.jmp(wbegin);  // ... or jump back to the loop's beginning
+  assembler.jg(wend);                                       // ... jump out of the loop
+  assembler.dec(asmjit::x86::qword_ptr(asmjit::x86::rsp));  // ... or jump back to the loop's beginning unless we
+  assembler.jnz(wbegin);                                    //     ran out of rounds
   assembler.bind(wend);
+  assembler.add(asmjit::x86::rsp, 8);
+
+  if (trace!=nullptr) emit_trace_record(assembler, true);
+}
+
+void CodeJitter::emit_trace_record(asmjit::x86::Assembler &assembler, bool sync_end) {
+  // rdx holds the synchronization counter, rcx and rax are scratch registers
+  assembler.push(asmjit::x86::rdx);
+  assembler.rdtscp();  // result of rdtscp is in [edx:eax]
+  assembler.shl(asmjit::x86::rdx, 32);
+  assembler.or_(asmjit::x86::rax, asmjit::x86::rdx);
+
+  // rdx = &records[num_records%CAPACITY]
+  assembler.mov(asmjit::x86::rcx, (uint64_t) &trace->state);
+  assembler.mov(asmjit::x86::rdx, asmjit::x86::qword_ptr(asmjit::x86::rcx, offsetof(TimingTraceState, num_records)));
+  assembler.and_(asmjit::x86::rdx, static_cast<int32_t>(TimingTrace::CAPACITY - 1));
+  assembler.shl(asmjit::x86::rdx, 5);
+  static_assert(sizeof(TimingTraceRecord)==(1 << 5), "TimingTraceRecord must be 32 bytes");
+  assembler.add(asmjit::x86::rdx, asmjit::x86::qword_ptr(asmjit::x86::rcx, offsetof(TimingTraceState, records)));
+
+  if (!sync_end) {
+    assembler.mov(asmjit::x86::qword_ptr(asmjit::x86::rdx, offsetof(TimingTraceRecord, sync_begin)), asmjit::x86::rax);
+  } else {
+    assembler.mov(asmjit::x86::qword_ptr(asmjit::x86::rdx, offsetof(TimingTraceRecord, sync_end)), asmjit::x86::rax);
+    assembler.mov(asmjit::x86::qword_ptr(asmjit::x86::rdx, offsetof(TimingTraceRecord, remaining_acts)),
+        asmjit::x86::rsi);
+    // the saved synchronization counter is on top of the stack
+    assembler.mov(asmjit::x86::rax, asmjit::x86::qword_ptr(asmjit::x86::rsp));
+    assembler.mov(asmjit::x86::qword_ptr(asmjit::x86::rdx, offsetof(TimingTraceRecord, sync_acts)), asmjit::x86::rax);
+    assembler.inc(asmjit::x86::qword_ptr(asmjit::x86::rcx, offsetof(TimingTraceState, num_records)));
+  }
+  assembler.pop(asmjit::x86::rdx);
 }
 #endif
 
@@ -281,17 +793,32 @@ void to_json(nlohmann::json &j, const CodeJitter &p) {
   j = {{"pattern_sync_each_ref", p.pattern_sync_each_ref},
        {"flushing_strategy", to_string(p.flushing_strategy)},
        {"fencing_strategy", to_string(p.fencing_strategy)},
+       {"access_strategy", to_string(p.access_strategy)},
+       {"flush_instruction", to_string(p.flush_instruction)},
        {"total_activations", p.total_activations},
        {"num_aggs_for_sync", p.num_aggs_for_sync}
   };
+  if (p.trace_stats.num_syncs > 0) j["timing_trace"] = p.trace_stats;
 }
 
 void from_json(const nlohmann::json &j, CodeJitter &p) {
   j.at("pattern_sync_each_ref").get_to(p.pattern_sync_each_ref);
   from_string(j.at("flushing_strategy"), p.flushing_strategy);
   from_string(j.at("fencing_strategy"), p.fencing_strategy);
+  // older JSON files do not contain the instructions, these were always plain loads and clflushopt
+  if (j.contains("access_strategy")) {
+    from_string(j.at("access_strategy"), p.access_strategy);
+  } else {
+    p.access_strategy = ACCESS_STRATEGY::LOAD;
+  }
+  if (j.contains("flush_instruction")) {
+    from_string(j.at("flush_instruction"), p.flush_instruction);
+  } else {
+    p.flush_instruction = FLUSH_INSTRUCTION::CLFLUSHOPT;
+  }
   j.at("total_activations").get_to(p.total_activations);
   j.at("num_aggs_for_sync").get_to(p.num_aggs_for_sync);
+  if (j.contains("timing_trace")) j.at("timing_trace").get_to(p.trace_stats);
 }
 
 #endif
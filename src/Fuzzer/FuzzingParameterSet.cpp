@@ -7,10 +7,13 @@
 #endif
 
 #include "GlobalDefines.hpp"
+#include "Memory/DRAMAddr.hpp"
 
 FuzzingParameterSet::FuzzingParameterSet(int measured_num_acts_per_ref) : /* NOLINT */
     flushing_strategy(FLUSHING_STRATEGY::EARLIEST_POSSIBLE),
-    fencing_strategy(FENCING_STRATEGY::LATEST_POSSIBLE) {
+    fencing_strategy(FENCING_STRATEGY::LATEST_POSSIBLE),
+    access_strategy(ACCESS_STRATEGY::LOAD),
+    flush_instruction(get_supported_flush_instructions().front()) {
   std::random_device rd;
   gen = std::mt19937(rd());  // standard mersenne_twister_engine seeded with some random data
 
@@ -37,6 +40,8 @@ void FuzzingParameterSet::print_semi_dynamic_parameters() const {
   Logger::log_data(format_string("agg_inter_distance: %d", agg_inter_distance));
   Logger::log_data(format_string("flushing_strategy: %s", to_string(flushing_strategy).c_str()));
   Logger::log_data(format_string("fencing_strategy: %s", to_string(fencing_strategy).c_str()));
+  Logger::log_data(format_string("access_strategy: %s", to_string(access_strategy).c_str()));
+  Logger::log_data(format_string("flush_instruction: %s", to_string(flush_instruction).c_str()));
 }
 
 void FuzzingParameterSet::print_dynamic_parameters(const int bank, bool seq_addresses, int start_row) {
@@ -90,6 +95,12 @@ void FuzzingParameterSet::set_num_activations_per_t_refi(int num_activations_per
   this->num_activations_per_tREFI = (num_activations_per_t_refi/2)*2;
 }
 
+bool FuzzingParameterSet::set_num_activations_per_t_refi(const ActsPerTrefiEstimator &estimator) {
+  if (estimator.get_confidence() < ActsPerTrefiEstimator::MIN_CONFIDENCE || estimator.get_estimate()==0) return false;
+  set_num_activations_per_t_refi(static_cast<int>(estimator.get_estimate()));
+  return true;
+}
+
 void FuzzingParameterSet::randomize_parameters(bool print) {
   if (num_activations_per_tREFI <= 0) {
     Logger::log_error(
@@ -157,7 +168,8 @@ void FuzzingParameterSet::randomize_parameters(bool print) {
   //    num_activations_per_tREFI ≈100                       => 8k * 100 ≈ 8M activations and we hammer for 5M acts.
   hammering_total_num_activations = 5000000;
 
-  max_row_no = 8192;
+  // the rows of all allocated superpages
+  max_row_no = static_cast<int>(DRAMAddr::get_num_rows());
 
   // █████████ SEMI-DYNAMIC FUZZING PARAMETERS ████████████████████████████████████████████████████
   // are only randomized once when calling this function
@@ -178,6 +190,13 @@ void FuzzingParameterSet::randomize_parameters(bool print) {
 
   // [derivable from aggressor_to_addr (DRAMAddr) in PatternAddressMapper]
   agg_inter_distance = Range<int>(1, 24).get_random_number(gen);
+
+  // [included in CodeJitter]
+  // only pick instructions that the CPU we are running on supports (determined using cpuid)
+  const auto &access_strategies = get_supported_access_strategies();
+  access_strategy = access_strategies[Range<size_t>(0, access_strategies.size() - 1).get_random_number(gen)];
+  const auto &flush_instructions = get_supported_flush_instructions();
+  flush_instruction = flush_instructions[Range<size_t>(0, flush_instructions.size() - 1).get_random_number(gen)];
   
   if (print) print_semi_dynamic_parameters();
 }
@@ -0,0 +1,213 @@
+#include "Fuzzer/HammerInterpreter.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "GlobalDefines.hpp"
+#include "Memory/RefTiming.hpp"
+#include "Utilities/AsmPrimitives.hpp"
+
+HammerInterpreter::HammerInterpreter()
+    : flushing(FLUSHING_STRATEGY::EARLIEST_POSSIBLE),
+      fencing(FENCING_STRATEGY::LATEST_POSSIBLE),
+      access_strategy(ACCESS_STRATEGY::LOAD),
+      flush_instruction(FLUSH_INSTRUCTION::CLFLUSHOPT),
+      num_timed_accesses(0),
+      round_length(1),
+      total_num_activations(0),
+      trace(nullptr) {
+}
+
+void HammerInterpreter::prepare(int num_acts_per_trefi,
+                                FLUSHING_STRATEGY flushing_strategy,
+                                FENCING_STRATEGY fencing_strategy,
+                                ACCESS_STRATEGY access,
+                                FLUSH_INSTRUCTION flush,
+                                const std::vector<volatile char *> &aggressor_pairs,
+                                bool sync_at_each_ref,
+                                int num_aggressors_for_sync,
+                                int total_activations,
+                                size_t num_interleaved_sequences) {
+  accesses = aggressor_pairs;
+  flushing = flushing_strategy;
+  fencing = fencing_strategy;
+  access_strategy = access;
+  flush_instruction = flush;
+  num_timed_accesses = static_cast<size_t>(num_aggressors_for_sync);
+  round_length = std::max<size_t>(1, num_interleaved_sequences);
+  total_num_activations = total_activations;
+
+  // this follows the bookkeeping done by CodeJitter::jit_internal while emitting the accesses
+  flags.assign(accesses.size(), 0);
+  std::unordered_map<uint64_t, bool> accessed_before;
+  size_t cnt_total_activations = 0;
+  for (size_t i = num_timed_accesses; i + num_timed_accesses < accesses.size(); ++i) {
+    auto &before = accessed_before[(uint64_t) accesses[i]];
+    if (before) flags[i] |= ACCESSED_BEFORE;
+    before = true;
+    cnt_total_activations++;
+    if (sync_at_each_ref && (cnt_total_activations%static_cast<size_t>(num_acts_per_trefi))==0) flags[i] |= SYNC_AFTER;
+  }
+
+  // in an interleaved sequence, the flushes and the fence are done once at the beginning of each round (like
+  // CodeJitter::jit_internal, we do not flush and fence in a partial round before the first complete one)
+  if (round_length > 1) {
+    for (size_t i = num_timed_accesses; i + num_timed_accesses < accesses.size(); ++i) {
+      if (!(flags[i] & ACCESSED_BEFORE)) continue;
+      flags[i] = static_cast<uint8_t>((flags[i] & ~ACCESSED_BEFORE) | FLUSH_IN_ROUND);
+      const size_t round_begin = i - i%round_length;
+      if (round_begin >= num_timed_accesses) flags[round_begin] |= ROUND_BEGIN;
+    }
+  }
+}
+
+void HammerInterpreter::set_addresses(const std::vector<volatile char *> &aggressor_pairs) {
+  accesses = aggressor_pairs;
+}
+
+void HammerInterpreter::set_trace(TimingTrace *timing_trace) {
+  trace = timing_trace;
+}
+
+bool HammerInterpreter::is_prepared() const {
+  return !accesses.empty();
+}
+
+void HammerInterpreter::clear() {
+  accesses.clear();
+  flags.clear();
+}
+
+inline __attribute__((always_inline)) void HammerInterpreter::access(volatile char *addr, ACCESS_STRATEGY strategy) {
+  switch (strategy) {
+    case ACCESS_STRATEGY::NONTEMPORAL_LOAD:
+      nontemporal_load(addr);
+      break;
+    case ACCESS_STRATEGY::PREFETCHNTA:
+      prefetchnta(addr);
+      break;
+    case ACCESS_STRATEGY::STORE:
+      add_zero(addr);
+      break;
+    case ACCESS_STRATEGY::LOAD:
+    default:
+      (void) *addr;
+      break;
+  }
+}
+
+inline __attribute__((always_inline)) void HammerInterpreter::flush(volatile char *addr, FLUSH_INSTRUCTION instruction) {
+  switch (instruction) {
+    case FLUSH_INSTRUCTION::CLFLUSH:
+      clflush(addr);
+      break;
+    case FLUSH_INSTRUCTION::CLWB:
+      clwb(addr);
+      break;
+    case FLUSH_INSTRUCTION::CLFLUSHOPT:
+    default:
+      clflushopt(addr);
+      break;
+  }
+}
+
+int HammerInterpreter::sync_ref(volatile char *const *aggs, size_t num_aggs) {
+  const auto evicting_flush = get_supported_flush_instructions().front();
+  const auto ref_threshold = RefTiming::get_threshold();
+  int num_sync_acts = 0;
+  // give up after MAX_SYNC_ROUNDS such that a missed REFRESH does not stall hammering forever
+  for (size_t round = 0; round < MAX_SYNC_ROUNDS; ++round) {
+    mfence();
+    lfence();
+    const auto before = rdtscp();
+    lfence();
+    for (size_t i = 0; i < num_aggs; ++i) {
+      flush(aggs[i], evicting_flush);
+      (void) *aggs[i];
+      num_sync_acts++;
+    }
+    const auto after = rdtscp();
+    lfence();
+    if ((after - before) > ref_threshold) break;
+  }
+  return num_sync_acts;
+}
+
+template<FLUSHING_STRATEGY flushing_strategy, FENCING_STRATEGY fencing_strategy>
+int HammerInterpreter::hammer_internal() const {
+  volatile char *const *aggs = accesses.data();
+  const uint8_t *access_flags = flags.data();
+  const size_t first_access = num_timed_accesses;
+  const size_t end_access = accesses.size() - num_timed_accesses;
+  const auto access_instr = access_strategy;
+  const auto flush_instr = flush_instruction;
+  const auto evicting_flush = get_supported_flush_instructions().front();
+  const auto ref_threshold = RefTiming::get_threshold();
+
+  // ------- part 1: synchronize with the beginning of an interval ---------------------------
+  for (size_t i = 0; i < num_timed_accesses; ++i) (void) *aggs[i];
+  for (size_t round = 0; round < MAX_SYNC_ROUNDS; ++round) {
+    for (size_t i = 0; i < num_timed_accesses; ++i) flush(aggs[i], evicting_flush);
+    mfence();
+    const auto before = rdtscp();
+    lfence();
+    for (size_t i = 0; i < num_timed_accesses; ++i) (void) *aggs[i];
+    if ((rdtscp() - before) > ref_threshold) break;
+  }
+
+  // ------- part 2: perform hammering ---------------------------------------------------------
+  int num_sync_acts = 0;
+  for (int remaining = total_num_activations; remaining > 0;) {
+    for (size_t i = first_access; i < end_access; ++i) {
+      if (access_flags[i] & ROUND_BEGIN) {
+        if constexpr (flushing_strategy==FLUSHING_STRATEGY::LATEST_POSSIBLE) {
+          for (size_t j = i; j < std::min(i + round_length, end_access); ++j) {
+            if (access_flags[j] & FLUSH_IN_ROUND) flush(aggs[j], flush_instr);
+          }
+        }
+        if constexpr (fencing_strategy==FENCING_STRATEGY::LATEST_POSSIBLE) mfence();
+      }
+      if constexpr (flushing_strategy==FLUSHING_STRATEGY::LATEST_POSSIBLE) {
+        if (access_flags[i] & ACCESSED_BEFORE) flush(aggs[i], flush_instr);
+      }
+      if constexpr (fencing_strategy==FENCING_STRATEGY::LATEST_POSSIBLE) {
+        if (access_flags[i] & ACCESSED_BEFORE) mfence();
+      }
+      access(aggs[i], access_instr);
+      if constexpr (flushing_strategy==FLUSHING_STRATEGY::EARLIEST_POSSIBLE) flush(aggs[i], flush_instr);
+      if (access_flags[i] & SYNC_AFTER) {
+        const auto sync_begin = (trace!=nullptr) ? rdtscp() : 0;
+        num_sync_acts += sync_ref(aggs + i, std::min(num_timed_accesses, accesses.size() - i));
+        if (trace!=nullptr) {
+          trace->record(sync_begin, rdtscp(), static_cast<uint64_t>(remaining - static_cast<int>(i - first_access + 1)),
+              static_cast<uint64_t>(num_sync_acts));
+        }
+      }
+    }
+    remaining -= static_cast<int>(end_access - first_access);
+    mfence();
+
+    // ------- part 3: synchronize with the end ------------------------------------------------
+    const auto sync_begin = (trace!=nullptr) ? rdtscp() : 0;
+    num_sync_acts += sync_ref(aggs + end_access, num_timed_accesses);
+    if (trace!=nullptr) {
+      trace->record(sync_begin, rdtscp(), static_cast<uint64_t>(remaining),
+          static_cast<uint64_t>(num_sync_acts));
+    }
+  }
+  return num_sync_acts;
+}
+
+int HammerInterpreter::hammer() const {
+  if (!is_prepared()) return -1;
+  // the jitted code only emits fences for LATEST_POSSIBLE, hence all other fencing strategies behave like OMIT_FENCING
+  const bool fence_latest = (fencing==FENCING_STRATEGY::LATEST_POSSIBLE);
+  if (flushing==FLUSHING_STRATEGY::LATEST_POSSIBLE) {
+    return fence_latest
+           ? hammer_internal<FLUSHING_STRATEGY::LATEST_POSSIBLE, FENCING_STRATEGY::LATEST_POSSIBLE>()
+           : hammer_internal<FLUSHING_STRATEGY::LATEST_POSSIBLE, FENCING_STRATEGY::OMIT_FENCING>();
+  }
+  return fence_latest
+         ? hammer_internal<FLUSHING_STRATEGY::EARLIEST_POSSIBLE, FENCING_STRATEGY::LATEST_POSSIBLE>()
+         : hammer_internal<FLUSHING_STRATEGY::EARLIEST_POSSIBLE, FENCING_STRATEGY::OMIT_FENCING>();
+}
@@ -0,0 +1,95 @@
+#include "Fuzzer/JitCodeArena.hpp"
+
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "Utilities/Logger.hpp"
+
+JitCodeArena::JitCodeArena() : base(nullptr), size(ARENA_SIZE), huge_pages(true), used_bytes(0) {
+  // try to back the region by huge pages from the pool first, otherwise fall back to transparent huge pages
+  auto mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (mapped==MAP_FAILED) {
+    huge_pages = false;
+    mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped==MAP_FAILED) {
+      Logger::log_error("Could not map the memory for jitted code. Error:");
+      Logger::log_data(std::strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    madvise(mapped, size, MADV_HUGEPAGE);
+  }
+  base = static_cast<char *>(mapped);
+  free_chunks.emplace(0, size);
+  Logger::log_info(format_string("Mapped %zu MB for jitted code (%s).", size/(1024*1024),
+      huge_pages ? "huge pages" : "transparent huge pages"));
+}
+
+JitCodeArena::~JitCodeArena() {
+  munmap(base, size);
+}
+
+JitCodeArena &JitCodeArena::instance() {
+  static JitCodeArena arena;
+  return arena;
+}
+
+void *JitCodeArena::allocate(size_t num_bytes) {
+  const size_t chunk_size = ((num_bytes + ALIGNMENT - 1)/ALIGNMENT)*ALIGNMENT;
+  if (chunk_size==0) return nullptr;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  // first fit: this keeps the functions close together at the beginning of the region
+  for (auto it = free_chunks.begin(); it!=free_chunks.end(); ++it) {
+    if (it->second < chunk_size) continue;
+    const auto offset = it->first;
+    const auto remaining = it->second - chunk_size;
+    free_chunks.erase(it);
+    if (remaining > 0) free_chunks.emplace(offset + chunk_size, remaining);
+    void *ptr = base + offset;
+    allocated_chunks.emplace(ptr, chunk_size);
+    used_bytes += chunk_size;
+    return ptr;
+  }
+  return nullptr;
+}
+
+void JitCodeArena::release(void *ptr) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto chunk = allocated_chunks.find(ptr);
+  if (chunk==allocated_chunks.end()) {
+    Logger::log_error(format_string("Tried to release %p, which is not part of the jitted code arena.", ptr));
+    return;
+  }
+  size_t offset = static_cast<size_t>(static_cast<char *>(ptr) - base);
+  size_t chunk_size = chunk->second;
+  allocated_chunks.erase(chunk);
+  used_bytes -= chunk_size;
+
+  // merge the chunk with its free neighbors to avoid fragmentation
+  auto next = free_chunks.lower_bound(offset);
+  if (next!=free_chunks.end() && offset + chunk_size==next->first) {
+    chunk_size += next->second;
+    next = free_chunks.erase(next);
+  }
+  if (next!=free_chunks.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second==offset) {
+      prev->second += chunk_size;
+      return;
+    }
+  }
+  free_chunks.emplace(offset, chunk_size);
+}
+
+size_t JitCodeArena::get_used_bytes() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return used_bytes;
+}
+
+bool JitCodeArena::uses_huge_pages() const {
+  return huge_pages;
+}
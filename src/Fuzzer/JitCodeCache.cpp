@@ -0,0 +1,111 @@
+#include "Fuzzer/JitCodeCache.hpp"
+
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "Utilities/Logger.hpp"
+
+JitCodeCache &JitCodeCache::instance() {
+  static JitCodeCache cache;
+  return cache;
+}
+
+void JitCodeCache::open(const std::string &cache_directory, volatile char *memory_base_address,
+                        uint64_t code_generator_id) {
+  if (mkdir(cache_directory.c_str(), 0755)!=0 && errno!=EEXIST) {
+    Logger::log_error(format_string("Could not create the jitted code cache directory %s, continuing without it.",
+        cache_directory.c_str()));
+    Logger::log_data(std::strerror(errno));
+    return;
+  }
+  directory = cache_directory;
+  base_address = (uint64_t) memory_base_address;
+  generator_id = code_generator_id;
+  Logger::log_info(format_string("Using the jitted code cache in %s for memory at %p.", directory.c_str(),
+      memory_base_address));
+}
+
+bool JitCodeCache::is_open() const {
+  return !directory.empty();
+}
+
+uint64_t JitCodeCache::hash(const void *data, size_t num_bytes, uint64_t seed) {
+  auto bytes = static_cast<const uint8_t *>(data);
+  uint64_t h = seed;
+  for (size_t i = 0; i < num_bytes; ++i) {
+    h ^= bytes[i];
+    h *= 0x100000001b3;
+  }
+  return h;
+}
+
+std::string JitCodeCache::get_filename(uint64_t key) const {
+  std::stringstream ss;
+  ss << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+  return ss.str();
+}
+
+bool JitCodeCache::load(uint64_t key, size_t num_accesses, Entry &entry) {
+  std::ifstream file(get_filename(key), std::ios::binary);
+  FileHeader header{};
+  bool valid = file.is_open() && file.read(reinterpret_cast<char *>(&header), sizeof(header))
+      && header.magic==MAGIC && header.key==key && header.num_accesses==num_accesses && header.code_size > 0;
+  // the code was emitted by another build whose code generator may differ from ours, hence we must not execute it
+  const bool stale = valid && header.generator_id!=generator_id;
+  valid = valid && !stale;
+  if (valid && header.base_address!=base_address) {
+    // the embedded addresses point into a memory area that is not mapped at the same address in this run
+    Logger::log_error(format_string("Ignoring jitted code cache entry %016lx that was created for memory at %p.", key,
+        (void *) header.base_address));
+    valid = false;
+  }
+  if (valid) {
+    entry.code.resize(header.code_size);
+    valid = static_cast<bool>(file.read(reinterpret_cast<char *>(entry.code.data()),
+        static_cast<std::streamsize>(header.code_size)));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!valid) {
+    num_misses++;
+    num_stale += stale;
+    return false;
+  }
+  entry.loop_body_accesses = static_cast<int>(header.loop_body_accesses);
+  entry.loop_iterations = static_cast<int>(header.loop_iterations);
+  entry.num_register_aggressors = header.num_register_aggressors;
+  num_hits++;
+  return true;
+}
+
+void JitCodeCache::store(uint64_t key, size_t num_accesses, const Entry &entry) {
+  // write into a temporary file first such that a concurrent or interrupted run never reads a partial entry
+  const auto filename = get_filename(key);
+  const auto tmp_filename = filename + ".tmp";
+  std::ofstream file(tmp_filename, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    Logger::log_error(format_string("Could not write jitted code cache entry %s.", filename.c_str()));
+    return;
+  }
+  const FileHeader header{MAGIC, generator_id, key, base_address, num_accesses, entry.code.size(), entry.loop_body_accesses,
+                          entry.loop_iterations, entry.num_register_aggressors};
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(entry.code.data()), static_cast<std::streamsize>(entry.code.size()));
+  file.close();
+  if (!file || std::rename(tmp_filename.c_str(), filename.c_str())!=0) {
+    Logger::log_error(format_string("Could not write jitted code cache entry %s.", filename.c_str()));
+    std::remove(tmp_filename.c_str());
+  }
+}
+
+void JitCodeCache::log_stats() {
+  if (!is_open()) return;
+  std::lock_guard<std::mutex> lock(mutex);
+  Logger::log_info(format_string("Jitted code cache: %zu functions loaded, %zu functions jitted and added (%zu of them "
+                                 "replaced entries of another build).", num_hits, num_misses, num_stale));
+}
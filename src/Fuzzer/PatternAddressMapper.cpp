@@ -8,6 +8,8 @@
 // initialize the bank_counter (static var)
 int PatternAddressMapper::bank_counter = 0;
 
+int PatternAddressMapper::reserved_bank = -1;
+
 PatternAddressMapper::PatternAddressMapper()
     : instance_id(uuid::gen_uuid()) { /* NOLINT */
   code_jitter = std::make_unique<CodeJitter>();
@@ -25,13 +27,21 @@ void PatternAddressMapper::randomize_addresses(FuzzingParameterSet &fuzzing_para
 
   // retrieve and then store randomized values as they should be the same for all added addresses
   // (store bank_no as field for get_random_nonaccessed_rows)
-  bank_no = PatternAddressMapper::bank_counter;
-  PatternAddressMapper::bank_counter = (PatternAddressMapper::bank_counter + 1) % NUM_BANKS;
+  // (skip the reserved bank as hammering it would interfere with the one accessing it concurrently)
+  do {
+    bank_no = PatternAddressMapper::bank_counter;
+    PatternAddressMapper::bank_counter = (PatternAddressMapper::bank_counter + 1) % NUM_BANKS;
+  } while (bank_no==PatternAddressMapper::reserved_bank && NUM_BANKS > 1);
   const bool use_seq_addresses = fuzzing_params.get_random_use_seq_addresses();
   const int start_row = fuzzing_params.get_random_start_row();
   if (verbose) FuzzingParameterSet::print_dynamic_parameters(bank_no, use_seq_addresses, start_row);
 
-  auto cur_row = static_cast<size_t>(start_row);
+  // rows of different superpages are not physically adjacent, hence we place all aggressors of a mapping into the
+  // same (randomly chosen) superpage and wrap around at its boundaries
+  const size_t rows_per_superpage = DRAMAddr::get_num_rows_per_superpage();
+  const size_t num_superpages = DRAMAddr::get_num_rows()/rows_per_superpage;
+  const size_t first_row = (Range<size_t>(1, num_superpages).get_random_number(gen) - 1)*rows_per_superpage;
+  auto cur_row = first_row + static_cast<size_t>(start_row)%rows_per_superpage;
 
   // a set of DRAM rows that are already assigned to aggressors
   std::set<size_t> occupied_rows;
@@ -89,14 +99,14 @@ void PatternAddressMapper::randomize_addresses(FuzzingParameterSet &fuzzing_para
         // we need to add the appropriate distance and cannot choose randomly
         auto last_addr = aggressor_to_addr.at(acc_pattern.aggressors.at(i - 1).id);
         // update cur_row for its next use (note that here it is: cur_row = last_addr.row)
-        cur_row = (last_addr.row + (size_t) fuzzing_params.get_agg_intra_distance())%fuzzing_params.get_max_row_no();
+        cur_row = DRAMAddr::shift_row(last_addr.row, fuzzing_params.get_agg_intra_distance());
         row = cur_row;
       } else {
         // this is a new aggressor pair - we can choose where to place it
         // if use_seq_addresses is true, we use the last address and add the agg_inter_distance on top -> this is the
         //   row of the next aggressor
-        // if use_seq_addresses is false, we just pick any random row no. between [0, 8192]
-        cur_row = (cur_row + (size_t) fuzzing_params.get_agg_inter_distance())%fuzzing_params.get_max_row_no();
+        // if use_seq_addresses is false, we just pick any random row no. within the mapping's superpage
+        cur_row = DRAMAddr::shift_row(cur_row, fuzzing_params.get_agg_inter_distance());
 
         bool map_to_existing_agg = dist(engine);
         if (map_to_existing_agg && !occupied_rows.empty()) {
@@ -108,8 +118,7 @@ void PatternAddressMapper::randomize_addresses(FuzzingParameterSet &fuzzing_para
         retry:
           row = use_seq_addresses ?
                 cur_row :
-                (Range<size_t>(cur_row, cur_row + fuzzing_params.get_max_row_no()).get_random_number(gen)
-                    %fuzzing_params.get_max_row_no());
+                first_row + Range<size_t>(0, rows_per_superpage - 1).get_random_number(gen);
 
           // check that we haven't assigned this address yet to another aggressor ID
           // if use_seq_addresses is True, the only way that the address is already assigned is that we already flipped
@@ -146,6 +155,8 @@ void PatternAddressMapper::determine_victims(const std::vector<AggressorAccessPa
   const int ROW_THRESHOLD = 5;
   // a set to make sure we add victims only once
   victim_rows.clear();
+  // collect all victim candidates first so that we can translate them in a single pass
+  std::vector<DRAMAddr> victim_candidates;
   for (auto &acc_pattern : agg_access_patterns) {
     for (auto &agg : acc_pattern.aggressors) {
 
@@ -159,19 +170,21 @@ void PatternAddressMapper::determine_victims(const std::vector<AggressorAccessPa
       for (int delta_nrows = -ROW_THRESHOLD; delta_nrows <= ROW_THRESHOLD; ++delta_nrows) {
         auto cur_row_candidate = static_cast<int>(dram_addr.row) + delta_nrows;
 
-        // don't add the aggressor itself and ignore any non-existing (negative) row no.
-        if (delta_nrows == 0 || cur_row_candidate < 0)
-          continue;
-
-        // ignore this victim if we already added it before
-        auto victim_start = DRAMAddr(dram_addr.bank, static_cast<size_t>(cur_row_candidate), 0);
-        if (victim_rows.count(static_cast<volatile char *>(victim_start.to_virt())) > 0)
+        // don't add the aggressor itself and ignore any non-existing (negative) row no. as well as rows of another
+        // superpage as these are not physically adjacent to the aggressor
+        if (delta_nrows == 0 || cur_row_candidate < 0
+            || DRAMAddr::shift_row(dram_addr.row, delta_nrows) != static_cast<size_t>(cur_row_candidate))
           continue;
 
-        victim_rows.insert(static_cast<volatile char *>(victim_start.to_virt()));
+        victim_candidates.emplace_back(dram_addr.bank, static_cast<size_t>(cur_row_candidate), 0);
       }
     }
   }
+
+  // the set ignores any victim that we already added before
+  std::vector<volatile char *> victim_addrs;
+  DRAMAddr::to_virt(victim_candidates, victim_addrs);
+  victim_rows.insert(victim_addrs.begin(), victim_addrs.end());
 }
 
 void PatternAddressMapper::export_pattern_internal(
@@ -181,6 +194,7 @@ void PatternAddressMapper::export_pattern_internal(
 
   bool invalid_aggs = false;
   std::stringstream pattern_str;
+  std::vector<DRAMAddr> dram_addrs;
   for (size_t i = 0; i < aggressors.size(); ++i) {
     // for better visualization: add linebreak after each base period
     if (i!=0 && (i%base_period)==0) {
@@ -201,12 +215,16 @@ void PatternAddressMapper::export_pattern_internal(
       continue;
     }
 
-    // retrieve virtual address of current aggressor in pattern and add it to output vector
-    addresses.push_back((volatile char *) aggressor_to_addr.at(agg.id).to_virt());
-    rows.push_back(static_cast<int>(aggressor_to_addr.at(agg.id).row));
-    pattern_str << aggressor_to_addr.at(agg.id).row << " ";
+    // retrieve DRAM address of current aggressor in pattern, it is translated to a virtual address below
+    const auto &dram_addr = aggressor_to_addr.at(agg.id);
+    dram_addrs.push_back(dram_addr);
+    rows.push_back(static_cast<int>(dram_addr.row));
+    pattern_str << dram_addr.row << " ";
   }
 
+  // translate the aggressors' DRAM addresses and add them to the output vector
+  DRAMAddr::to_virt(dram_addrs, addresses);
+
   // print string representation of pattern
 //  Logger::log_info("Pattern filled by random DRAM rows:");
 //  Logger::log_data(pattern_str.str());
@@ -308,12 +326,14 @@ const std::unordered_set<volatile char *> &PatternAddressMapper::get_victim_rows
 
 std::vector<volatile char *> PatternAddressMapper::get_random_nonaccessed_rows(int row_upper_bound) {
   // we don't mind if addresses are added multiple times
-  std::vector<volatile char *> addresses;
+  std::vector<DRAMAddr> dram_addrs;
+  dram_addrs.reserve(1024);
   for (int i = 0; i < 1024; ++i) {
     auto row_no = Range<int>(max_row, max_row + min_row).get_random_number(gen)%row_upper_bound;
-    addresses.push_back(
-        static_cast<volatile char*>(DRAMAddr(static_cast<size_t>(bank_no), static_cast<size_t>(row_no), 0).to_virt()));
+    dram_addrs.emplace_back(static_cast<size_t>(bank_no), static_cast<size_t>(row_no), 0);
   }
+  std::vector<volatile char *> addresses;
+  DRAMAddr::to_virt(dram_addrs, addresses);
   return addresses;
 }
 
@@ -332,7 +352,7 @@ void PatternAddressMapper::shift_mapping(int rows, const std::unordered_set<Aggr
     // if aggs_to_move is empty, we consider it as 'move all aggressors'; otherwise we check whether the current
     // aggressor ID is in aggs_to_move prior shifting the aggressor by the given number of rows (param: rows)
     if (aggs_to_move.empty() || movable_ids.count(agg_acc_patt.first) > 0) {
-      agg_acc_patt.second.row += rows;
+      agg_acc_patt.second.row = DRAMAddr::shift_row(agg_acc_patt.second.row, rows);
       occupied_rows.insert(static_cast<int>(agg_acc_patt.second.row));
     }
   }
@@ -355,12 +375,7 @@ PatternAddressMapper::PatternAddressMapper(const PatternAddressMapper &other)
       aggressor_to_addr(other.aggressor_to_addr),
       bit_flips(other.bit_flips),
       reproducibility_score(other.reproducibility_score) {
-  code_jitter = std::make_unique<CodeJitter>();
-  code_jitter->num_aggs_for_sync = other.get_code_jitter().num_aggs_for_sync;
-  code_jitter->total_activations = other.get_code_jitter().total_activations;
-  code_jitter->fencing_strategy = other.get_code_jitter().fencing_strategy;
-  code_jitter->flushing_strategy = other.get_code_jitter().flushing_strategy;
-  code_jitter->pattern_sync_each_ref = other.get_code_jitter().pattern_sync_each_ref;
+  code_jitter = std::make_unique<CodeJitter>(other.get_code_jitter());
   std::random_device rd;
   gen = std::mt19937(rd());
 }
@@ -371,12 +386,7 @@ PatternAddressMapper &PatternAddressMapper::operator=(const PatternAddressMapper
   instance_id = other.instance_id;
   gen = other.gen;
 
-  code_jitter = std::make_unique<CodeJitter>();
-  code_jitter->num_aggs_for_sync = other.get_code_jitter().num_aggs_for_sync;
-  code_jitter->total_activations = other.get_code_jitter().total_activations;
-  code_jitter->fencing_strategy = other.get_code_jitter().fencing_strategy;
-  code_jitter->flushing_strategy = other.get_code_jitter().flushing_strategy;
-  code_jitter->pattern_sync_each_ref = other.get_code_jitter().pattern_sync_each_ref;
+  *code_jitter = other.get_code_jitter();
 
   min_row = other.min_row;
   max_row = other.max_row;
@@ -439,14 +449,12 @@ void PatternAddressMapper::remap_aggressors(DRAMAddr &new_location) {
     smallest_row_no = std::min(smallest_row_no, addr.row);
   }
 
-  // compute offset between old start row and new start row
-  size_t offset = new_location.row - smallest_row_no;
-
   // now update each mapping's address
   for (auto &[id, addr]: aggressor_to_addr) {
     // we just overwrite the bank
     addr.bank = new_location.bank;
-    // for the row, we need to shift accordingly to preserve the distances between aggressors
-    addr.row += offset;
+    // for the row, we need to shift accordingly to preserve the distances between aggressors (within the superpage of
+    // the new location)
+    addr.row = DRAMAddr::shift_row(new_location.row, static_cast<long>(addr.row - smallest_row_no));
   }
 }
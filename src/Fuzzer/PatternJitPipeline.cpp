@@ -0,0 +1,187 @@
+#include "Fuzzer/PatternJitPipeline.hpp"
+
+#include <sched.h>
+#include <algorithm>
+#include <chrono>
+
+#include "Fuzzer/PatternBuilder.hpp"
+#include "Memory/Memory.hpp"
+#include "Utilities/TimeHelper.hpp"
+
+PatternJitPipeline::PatternJitPipeline(const FuzzingParameterSet &fuzzing_params, size_t probes_per_pattern,
+                                       size_t num_interleaved_banks)
+    : fuzzing_params(fuzzing_params), probes_per_pattern(probes_per_pattern),
+      num_interleaved_banks(std::max<size_t>(1, num_interleaved_banks)), queue(QUEUE_CAPACITY), running(false),
+      num_acts_per_trefi(fuzzing_params.get_num_activations_per_t_refi()), gen(std::random_device()()),
+      consumer_wait_us(0) {
+}
+
+PatternJitPipeline::~PatternJitPipeline() {
+  stop();
+}
+
+void PatternJitPipeline::start() {
+  if (running.exchange(true)) return;
+
+  // the ACTs per tREFI estimator uses the last CPU of the local NUMA node, we take the first one that is free
+  const auto cpus = Memory::get_numa_local_cpus();
+  const int cur_cpu = sched_getcpu();
+  auto it = std::find_if(cpus.begin(), cpus.end(), [cur_cpu](int c) { return c!=cur_cpu; });
+  const int cpu = (it!=cpus.end()) ? *it : -1;
+  producer = std::thread(&PatternJitPipeline::run, this, cpu);
+  if (cpu >= 0) {
+    Logger::log_info(format_string("Started pattern jitting thread on CPU %d.", cpu));
+  } else {
+    Logger::log_info("Started pattern jitting thread (no sibling CPU available to pin it to).");
+  }
+}
+
+void PatternJitPipeline::stop() {
+  if (!running.exchange(false)) return;
+  if (producer.joinable()) producer.join();
+  // release the jitted code of the jobs that were not hammered anymore
+  std::unique_ptr<PatternJob> job;
+  while (queue.try_pop(job)) job.reset();
+}
+
+std::unique_ptr<PatternJob> PatternJitPipeline::next_job() {
+  std::unique_ptr<PatternJob> job;
+  if (queue.try_pop(job)) return job;
+  const auto start_ts = get_timestamp_us();
+  while (!queue.try_pop(job)) std::this_thread::sleep_for(std::chrono::microseconds(100));
+  consumer_wait_us += get_timestamp_us() - start_ts;
+  return job;
+}
+
+void PatternJitPipeline::set_num_activations_per_t_refi(int acts) {
+  num_acts_per_trefi.store(acts, std::memory_order_relaxed);
+}
+
+int64_t PatternJitPipeline::get_consumer_wait_us() const {
+  return consumer_wait_us;
+}
+
+void PatternJitPipeline::run(int cpu) {
+  // pin the thread before jitting the first job such that it never runs on the hammering thread's CPU
+  if (cpu >= 0) Memory::pin_current_thread(cpu);
+  while (running.load(std::memory_order_relaxed)) {
+    auto job = create_job();
+    while (!queue.try_push(std::move(job))) {
+      if (!running.load(std::memory_order_relaxed)) return;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+std::unique_ptr<PatternJob> PatternJitPipeline::create_job() {
+  auto job = std::make_unique<PatternJob>();
+
+  // take over an updated number of ACTs per tREFI before generating the pattern
+  const int acts = num_acts_per_trefi.load(std::memory_order_relaxed);
+  if (acts!=fuzzing_params.get_num_activations_per_t_refi()) fuzzing_params.set_num_activations_per_t_refi(acts);
+
+  Logger::begin_capture();
+  fuzzing_params.randomize_parameters(true);
+
+  // generate a hammering pattern: this is like a general access pattern template without concrete addresses
+  job->pattern = HammeringPattern(fuzzing_params.get_base_period());
+  PatternBuilder pattern_builder(job->pattern);
+  pattern_builder.generate_frequency_based_pattern(fuzzing_params);
+
+  Logger::log_info("Abstract pattern based on aggressor IDs:");
+  Logger::log_data(job->pattern.get_pattern_text_repr());
+  Logger::log_info("Aggressor pairs, given as \"(id ...) : freq, amp, start_offset\":");
+  Logger::log_data(job->pattern.get_agg_access_pairs_text_repr());
+
+  // randomize the order of AggressorAccessPatterns to avoid biasing the PatternAddressMapper as it always assigns
+  // rows in order of the AggressorAccessPatterns map (e.g., first element is assigned to the lowest DRAM row).]
+  std::shuffle(job->pattern.agg_access_patterns.begin(), job->pattern.agg_access_patterns.end(), gen);
+  job->log = Logger::end_capture();
+
+  // then create N different mappings (i.e., address sets) for this pattern
+  job->num_interleaved_banks = num_interleaved_banks;
+  std::vector<std::vector<volatile char *>> group_accesses;
+  for (size_t i = 0; i < probes_per_pattern; ++i) {
+    auto mapping = std::make_unique<JittedMapping>();
+    Logger::begin_capture();
+    if (num_interleaved_banks==1) {
+      jit_mapping(job->pattern, fuzzing_params, *mapping);
+      mapping->log = Logger::end_capture();
+      job->mappings.push_back(std::move(mapping));
+      continue;
+    }
+    // consecutive mappings are on different banks as randomize_addresses assigns the banks round-robin
+    group_accesses.push_back(prepare_mapping(job->pattern, fuzzing_params, *mapping));
+    job->mappings.push_back(std::move(mapping));
+    if (group_accesses.size()==num_interleaved_banks || i + 1==probes_per_pattern) {
+      jit_interleaved_mappings(*job, group_accesses);
+      group_accesses.clear();
+    }
+    job->mappings.back()->log = Logger::end_capture();
+  }
+
+  job->fuzzing_params = fuzzing_params;
+  return job;
+}
+
+std::vector<volatile char *> PatternJitPipeline::prepare_mapping(HammeringPattern &pattern,
+                                                                 FuzzingParameterSet &fuzzing_params,
+                                                                 JittedMapping &mapping) {
+  PatternAddressMapper &mapper = mapping.mapper;
+
+  // randomize the aggressor ID -> DRAM row mapping
+  mapper.randomize_addresses(fuzzing_params, pattern.agg_access_patterns, true);
+
+  // now fill the pattern with these random addresses
+  std::vector<volatile char *> hammering_accesses_vec;
+  mapper.export_pattern(pattern.aggressors, pattern.base_period, hammering_accesses_vec);
+  Logger::log_info("Aggressor ID to DRAM address mapping (bank, row, column):");
+  Logger::log_data(mapper.get_mapping_text_repr());
+
+  mapping.sync_at_each_ref = fuzzing_params.get_random_sync_each_ref();
+  mapping.num_aggs_for_sync = fuzzing_params.get_random_num_aggressors_for_sync();
+  return hammering_accesses_vec;
+}
+
+void PatternJitPipeline::jit_mapping(HammeringPattern &pattern, FuzzingParameterSet &fuzzing_params,
+                                     JittedMapping &mapping) {
+  PatternAddressMapper &mapper = mapping.mapper;
+  auto hammering_accesses_vec = prepare_mapping(pattern, fuzzing_params, mapping);
+
+  // now create instructions that follow this pattern (i.e., do jitting of code)
+  Logger::log_info("Creating ASM code for hammering.");
+  mapper.get_code_jitter().access_strategy = fuzzing_params.access_strategy;
+  mapper.get_code_jitter().flush_instruction = fuzzing_params.flush_instruction;
+  mapper.get_code_jitter().jit_strict(fuzzing_params.get_num_activations_per_t_refi(),
+      fuzzing_params.flushing_strategy, fuzzing_params.fencing_strategy,
+      hammering_accesses_vec, mapping.sync_at_each_ref, mapping.num_aggs_for_sync,
+      fuzzing_params.get_hammering_total_num_activations(), pattern.base_period);
+}
+
+void PatternJitPipeline::jit_interleaved_mappings(PatternJob &job,
+                                                  const std::vector<std::vector<volatile char *>> &accesses) {
+  const size_t first_mapping = job.mappings.size() - accesses.size();
+  Logger::log_info(format_string("Creating ASM code for hammering mappings #%zu to #%zu interleaved on %zu banks.",
+      first_mapping, job.mappings.size() - 1, accesses.size()));
+
+  // all mappings of the group share the code jitting parameters of the group's first mapping
+  const JittedMapping &first = *job.mappings[first_mapping];
+  auto jitter = std::make_unique<CodeJitter>();
+  jitter->access_strategy = fuzzing_params.access_strategy;
+  jitter->flush_instruction = fuzzing_params.flush_instruction;
+  jitter->jit_interleaved(fuzzing_params.get_num_activations_per_t_refi(),
+      fuzzing_params.flushing_strategy, fuzzing_params.fencing_strategy,
+      accesses, first.sync_at_each_ref, first.num_aggs_for_sync,
+      fuzzing_params.get_hammering_total_num_activations(), job.pattern.base_period);
+
+  for (size_t i = first_mapping; i < job.mappings.size(); ++i) {
+    JittedMapping &mapping = *job.mappings[i];
+    mapping.sync_at_each_ref = first.sync_at_each_ref;
+    mapping.num_aggs_for_sync = first.num_aggs_for_sync;
+    // the mapper keeps the parameters (but not the code) such that it can be replayed on its own later
+    CodeJitter &mapper_jitter = mapping.mapper.get_code_jitter();
+    mapper_jitter = *jitter;
+    mapper_jitter.total_activations = fuzzing_params.get_hammering_total_num_activations();
+  }
+  job.interleaved_jitters.push_back(std::move(jitter));
+}
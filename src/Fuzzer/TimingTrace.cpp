@@ -0,0 +1,69 @@
+#include "Fuzzer/TimingTrace.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "GlobalDefines.hpp"
+
+TimingTrace::TimingTrace() : buffer(CAPACITY), state{0, buffer.data()} {
+}
+
+void TimingTrace::reset() {
+  state.num_records = 0;
+}
+
+TimingTraceStats TimingTrace::analyze(double cycles_per_ns) const {
+  TimingTraceStats stats;
+  const size_t num_records = std::min<size_t>(state.num_records, CAPACITY);
+  stats.num_syncs = num_records;
+  if (num_records==0 || cycles_per_ns <= 0) return stats;
+
+  // the oldest record that was not overwritten yet
+  const size_t first = static_cast<size_t>(state.num_records) - num_records;
+  auto at = [this, first](size_t i) -> const TimingTraceRecord & { return buffer[(first + i)%CAPACITY]; };
+
+  double sum_sync_cycles = 0;
+  for (size_t i = 0; i < num_records; ++i) {
+    sum_sync_cycles += static_cast<double>(at(i).sync_end - at(i).sync_begin);
+  }
+  stats.sync_cycles = sum_sync_cycles/static_cast<double>(num_records);
+  if (num_records < 2) return stats;
+
+  // the remaining activations are only updated at the end of a loop iteration, hence we only use the totals; the
+  // counter becomes negative in the last pattern round but the (modular) difference is still correct
+  const auto &oldest = at(0);
+  const auto &newest = at(num_records - 1);
+  const double elapsed_ns = static_cast<double>(newest.sync_end - oldest.sync_end)/cycles_per_ns;
+  const double num_acts = static_cast<double>(oldest.remaining_acts - newest.remaining_acts)
+      + static_cast<double>(newest.sync_acts - oldest.sync_acts);
+  if (elapsed_ns > 0) stats.acts_per_trefi = num_acts/(elapsed_ns/TREFI_NS);
+
+  // each synchronization ends right after a REFRESH, i.e., the time between two of them should be a multiple of tREFI
+  double sum_sq_deviation = 0;
+  for (size_t i = 1; i < num_records; ++i) {
+    const double interval_ns = static_cast<double>(at(i).sync_end - at(i - 1).sync_end)/cycles_per_ns;
+    const double deviation_ns = interval_ns - std::round(interval_ns/TREFI_NS)*TREFI_NS;
+    sum_sq_deviation += deviation_ns*deviation_ns;
+  }
+  stats.ref_jitter_ns = std::sqrt(sum_sq_deviation/static_cast<double>(num_records - 1));
+  return stats;
+}
+
+#ifdef ENABLE_JSON
+
+void to_json(nlohmann::json &j, const TimingTraceStats &p) {
+  j = nlohmann::json{{"num_syncs", p.num_syncs},
+                     {"acts_per_trefi", p.acts_per_trefi},
+                     {"ref_jitter_ns", p.ref_jitter_ns},
+                     {"sync_cycles", p.sync_cycles}
+  };
+}
+
+void from_json(const nlohmann::json &j, TimingTraceStats &p) {
+  j.at("num_syncs").get_to(p.num_syncs);
+  j.at("acts_per_trefi").get_to(p.acts_per_trefi);
+  j.at("ref_jitter_ns").get_to(p.ref_jitter_ns);
+  j.at("sync_cycles").get_to(p.sync_cycles);
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "Memory/ActsPerTrefiEstimator.hpp"
+
+#include <sched.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "GlobalDefines.hpp"
+#include "Memory/Memory.hpp"
+#include "Memory/RefTiming.hpp"
+#include "Utilities/AsmPrimitives.hpp"
+
+ActsPerTrefiEstimator::ActsPerTrefiEstimator(volatile char *same_bank_a, volatile char *same_bank_b,
+                                             size_t initial_estimate)
+    : addr_a(same_bank_a), addr_b(same_bank_b), state(static_cast<uint64_t>(initial_estimate) << 32),
+      running(false), num_batches(0), smoothed_deviation(0) {
+}
+
+ActsPerTrefiEstimator::~ActsPerTrefiEstimator() {
+  stop();
+}
+
+void ActsPerTrefiEstimator::start() {
+  if (running.exchange(true)) return;
+
+  // use a sibling core of the local NUMA node such that the estimator does not compete with the (pinned) hammering
+  // thread that is starting us
+  const auto cpus = Memory::get_numa_local_cpus();
+  const int cur_cpu = sched_getcpu();
+  auto it = std::find_if(cpus.rbegin(), cpus.rend(), [cur_cpu](int c) { return c!=cur_cpu; });
+  const int cpu = (it!=cpus.rend()) ? *it : -1;
+  worker = std::thread(&ActsPerTrefiEstimator::run, this, cpu);
+  if (cpu >= 0) {
+    Logger::log_info(format_string("Started ACTs per tREFI estimator on CPU %d.", cpu));
+  } else {
+    Logger::log_info("Started ACTs per tREFI estimator (no sibling CPU available to pin it to).");
+  }
+}
+
+void ActsPerTrefiEstimator::stop() {
+  if (!running.exchange(false)) return;
+  if (worker.joinable()) worker.join();
+}
+
+size_t ActsPerTrefiEstimator::get_estimate() const {
+  return static_cast<size_t>(state.load(std::memory_order_acquire) >> 32);
+}
+
+double ActsPerTrefiEstimator::get_confidence() const {
+  return static_cast<double>(state.load(std::memory_order_acquire) & 0xFFFFFFFFUL)/1000.0;
+}
+
+bool ActsPerTrefiEstimator::measure_batch(size_t num_intervals, double &mean, double &std_dev) {
+  // same measurement as DramAnalyzer::count_acts_per_trefi: a REFRESH shows up as an access taking longer than the
+  // REFRESH threshold, we count the accesses in between two of them
+  const size_t skip_first_N = 50;
+  const uint64_t max_accesses = 100UL*1000UL*1000UL;
+  std::vector<uint64_t> acts;
+  acts.reserve(num_intervals);
+  uint64_t count = 0;
+  uint64_t count_old = 0;
+  for (size_t i = 0; acts.size() < num_intervals && i < max_accesses && running.load(std::memory_order_relaxed); i++) {
+    clflushopt(addr_a);
+    clflushopt(addr_b);
+    mfence();
+    const uint64_t before = rdtscp();
+    lfence();
+    (void) *addr_a;
+    (void) *addr_b;
+    const uint64_t after = rdtscp();
+    count++;
+    if (RefTiming::is_refresh(after - before)) {
+      // multiply by 2 to account for both accesses we do (a, b)
+      if (i > skip_first_N && count_old!=0) acts.push_back((count - count_old)*2);
+      count_old = count;
+    }
+  }
+  if (acts.size() < num_intervals) return false;
+
+  // ignore intervals in which we were descheduled (i.e., that span several refresh intervals)
+  std::sort(acts.begin(), acts.end());
+  acts.resize(acts.size() - acts.size()/20);
+  double sum = 0;
+  for (const auto &a : acts) sum += static_cast<double>(a);
+  mean = sum/static_cast<double>(acts.size());
+  double var = 0;
+  for (const auto &a : acts) var += std::pow(static_cast<double>(a) - mean, 2);
+  std_dev = std::sqrt(var/static_cast<double>(acts.size()));
+  return true;
+}
+
+void ActsPerTrefiEstimator::run(int cpu) {
+  // pin the thread before the first measurement such that it never measures next to the hammering thread
+  if (cpu >= 0) Memory::pin_current_thread(cpu);
+  while (running.load(std::memory_order_relaxed)) {
+    double mean = 0;
+    double std_dev = 0;
+    if (measure_batch(INTERVALS_PER_BATCH, mean, std_dev) && mean > 0) {
+      const auto previous = static_cast<double>(get_estimate());
+      double estimate;
+      if (num_batches==0 && previous==0) {
+        estimate = mean;
+      } else {
+        const double reference = (previous > 0) ? previous : mean;
+        const double deviation = std::abs(mean - reference)/reference + std_dev/(mean*std::sqrt(INTERVALS_PER_BATCH));
+        smoothed_deviation = (num_batches==0)
+                             ? deviation : SMOOTHING_FACTOR*deviation + (1.0 - SMOOTHING_FACTOR)*smoothed_deviation;
+        estimate = SMOOTHING_FACTOR*mean + (1.0 - SMOOTHING_FACTOR)*reference;
+      }
+      num_batches++;
+
+      // the confidence grows with the number of batches and shrinks with the deviation between them
+      const double stability = std::max(0.0, 1.0 - smoothed_deviation/MAX_RELATIVE_DEVIATION);
+      const double confidence = stability*std::min(1.0, static_cast<double>(num_batches)/3.0);
+      state.store((static_cast<uint64_t>(std::lround(estimate)) << 32)
+                      | static_cast<uint64_t>(std::lround(confidence*1000.0)), std::memory_order_release);
+    }
+
+    // sleep in small steps to be able to stop quickly
+    for (size_t ms = 0; ms < BATCH_PERIOD_MS && running.load(std::memory_order_relaxed); ms += 10) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
@@ -1,10 +1,239 @@
 #include "Memory/DRAMAddr.hpp"
 #include "GlobalDefines.hpp"
+#include "Utilities/TimeHelper.hpp"
+
+#include <algorithm>
+#include <immintrin.h>
+#include <random>
+
+namespace {
+
+// The memory configurations are compile-time constants so that the translation functions can be instantiated for
+// each of them, i.e., all shifts, masks, and lookup tables become immediate operands.
+
+constexpr MemConfiguration SINGLE_RANK_CONFIG = {
+    .IDENTIFIER = (CHANS(1UL) | DIMMS(1UL) | RANKS(1UL) | BANKS(16UL)),
+    .BK_SHIFT =  26,
+    .BK_MASK =  (0b1111),
+    .ROW_SHIFT =  0,
+    .ROW_MASK =  (0b1111111111111),
+    .COL_SHIFT =  13,
+    .COL_MASK =  (0b1111111111111),
+    /* maps a virtual addr -> DRAM addr: bank (4 bits) | col (13 bits) | row (13 bits) */
+    .DRAM_MTX =  {
+        0b000000000000000010000001000000, /* 0x02040 bank b3 = addr b6 + b13 */
+        0b000000000000100100000000000000, /* 0x24000 bank b2 = addr b14 + b17 */
+        0b000000000001001000000000000000, /* 0x48000 bank b1 = addr b15 + b18 */
+        0b000000000010010000000000000000, /* 0x90000 bank b0 = addr b16 + b19 */
+        0b000000000000000010000000000000, /* col b12 = addr b13 */
+        0b000000000000000001000000000000, /* col b11 = addr b12 */
+        0b000000000000000000100000000000, /* col b10 = addr b11 */
+        0b000000000000000000010000000000, /* col b9 = addr b10 */
+        0b000000000000000000001000000000, /* col b8 = addr b9 */
+        0b000000000000000000000100000000, /* col b7 = addr b8*/
+        0b000000000000000000000010000000, /* col b6 = addr b7 */
+        0b000000000000000000000000100000, /* col b5 = addr b5 */
+        0b000000000000000000000000010000, /* col b4 = addr b4*/
+        0b000000000000000000000000001000, /* col b3 = addr b3 */
+        0b000000000000000000000000000100, /* col b2 = addr b2 */
+        0b000000000000000000000000000010, /* col b1 = addr b1 */
+        0b000000000000000000000000000001, /* col b0 = addr b0*/
+        0b100000000000000000000000000000, /* row b12 = addr b29 */
+        0b010000000000000000000000000000, /* row b11 = addr b28 */
+        0b001000000000000000000000000000, /* row b10 = addr b27 */
+        0b000100000000000000000000000000, /* row b9 = addr b26 */
+        0b000010000000000000000000000000, /* row b8 = addr b25 */
+        0b000001000000000000000000000000, /* row b7 = addr b24 */
+        0b000000100000000000000000000000, /* row b6 = addr b23 */
+        0b000000010000000000000000000000, /* row b5 = addr b22 */
+        0b000000001000000000000000000000, /* row b4 = addr b21 */
+        0b000000000100000000000000000000, /* row b3 = addr b20 */
+        0b000000000010000000000000000000, /* row b2 = addr b19 */
+        0b000000000001000000000000000000, /* row b1 = addr b18 */
+        0b000000000000100000000000000000, /* row b0 = addr b17 */
+        },
+    /* maps a DRAM addr (bank | col | row) --> virtual addr */
+    .ADDR_MTX =  {
+        0b000000000000000001000000000000, /* addr b29 = row b12 */
+        0b000000000000000000100000000000, /* addr b28 = row b11 */
+        0b000000000000000000010000000000, /* addr b27 = row b10 */
+        0b000000000000000000001000000000, /* addr b26 = row b9 */
+        0b000000000000000000000100000000, /* addr b25 = row b8 */
+        0b000000000000000000000010000000, /* addr b24 = row b7 */
+        0b000000000000000000000001000000, /* addr b23 = row b6 */
+        0b000000000000000000000000100000, /* addr b22 = row b5 */
+        0b000000000000000000000000010000, /* addr b21 = row b4 */
+        0b000000000000000000000000001000, /* addr b20 = row b3 */
+        0b000000000000000000000000000100, /* addr b19 = row b2 */
+        0b000000000000000000000000000010, /* addr b18 = row b1 */
+        0b000000000000000000000000000001, /* addr b17 = row b0 */
+        0b000100000000000000000000000100, /* addr b16 = bank b0 + row b2 (addr b19) */
+        0b001000000000000000000000000010, /* addr b15 = bank b1 + row b1 (addr b18) */
+        0b010000000000000000000000000001, /* addr b14 = bank b2 + row b0 (addr b17) */
+        0b000010000000000000000000000000, /* addr b13 = col b12 */
+        0b000001000000000000000000000000, /* addr b12 = col b11 */
+        0b000000100000000000000000000000, /* addr b11 = col b10 */
+        0b000000010000000000000000000000, /* addr b10 = col b9 */
+        0b000000001000000000000000000000, /* addr b9 = col b8 */
+        0b000000000100000000000000000000, /* addr b8 = col b7 */
+        0b000000000010000000000000000000, /* addr b7 = col b6 */
+        0b100010000000000000000000000000, /* addr b6 = bank b3 + col b12 (addr b13)*/
+        0b000000000001000000000000000000, /* addr b5 = col b5 */
+        0b000000000000100000000000000000, /* addr b4 = col b4 */
+        0b000000000000010000000000000000, /* addr b3 = col b3 */
+        0b000000000000001000000000000000, /* addr b2 = col b2 */
+        0b000000000000000100000000000000, /* addr b1 = col b1 */
+        0b000000000000000010000000000000  /* addr b0 = col b0 */
+    }
+};
+
+constexpr MemConfiguration DUAL_RANK_CONFIG = {
+    .IDENTIFIER = (CHANS(1UL) | DIMMS(1UL) | RANKS(2UL) | BANKS(16UL)),
+    .BK_SHIFT =  25,
+    .BK_MASK =  (0b11111),
+    .ROW_SHIFT =  0,
+    .ROW_MASK =  (0b111111111111),
+    .COL_SHIFT =  12,
+    .COL_MASK =  (0b1111111111111),
+    .DRAM_MTX =  {
+        0b000000000000000010000001000000,
+        0b000000000001000100000000000000,
+        0b000000000010001000000000000000,
+        0b000000000100010000000000000000,
+        0b000000001000100000000000000000,
+        0b000000000000000010000000000000,
+        0b000000000000000001000000000000,
+        0b000000000000000000100000000000,
+        0b000000000000000000010000000000,
+        0b000000000000000000001000000000,
+        0b000000000000000000000100000000,
+        0b000000000000000000000010000000,
+        0b000000000000000000000000100000,
+        0b000000000000000000000000010000,
+        0b000000000000000000000000001000,
+        0b000000000000000000000000000100,
+        0b000000000000000000000000000010,
+        0b000000000000000000000000000001,
+        0b100000000000000000000000000000,
+        0b010000000000000000000000000000,
+        0b001000000000000000000000000000,
+        0b000100000000000000000000000000,
+        0b000010000000000000000000000000,
+        0b000001000000000000000000000000,
+        0b000000100000000000000000000000,
+        0b000000010000000000000000000000,
+        0b000000001000000000000000000000,
+        0b000000000100000000000000000000,
+        0b000000000010000000000000000000,
+        0b000000000001000000000000000000
+    },
+    .ADDR_MTX =  {
+        0b000000000000000000100000000000,
+        0b000000000000000000010000000000,
+        0b000000000000000000001000000000,
+        0b000000000000000000000100000000,
+        0b000000000000000000000010000000,
+        0b000000000000000000000001000000,
+        0b000000000000000000000000100000,
+        0b000000000000000000000000010000,
+        0b000000000000000000000000001000,
+        0b000000000000000000000000000100,
+        0b000000000000000000000000000010,
+        0b000000000000000000000000000001,
+        0b000010000000000000000000001000,
+        0b000100000000000000000000000100,
+        0b001000000000000000000000000010,
+        0b010000000000000000000000000001,
+        0b000001000000000000000000000000,
+        0b000000100000000000000000000000,
+        0b000000010000000000000000000000,
+        0b000000001000000000000000000000,
+        0b000000000100000000000000000000,
+        0b000000000010000000000000000000,
+        0b000000000001000000000000000000,
+        0b100001000000000000000000000000,
+        0b000000000000100000000000000000,
+        0b000000000000010000000000000000,
+        0b000000000000001000000000000000,
+        0b000000000000000100000000000000,
+        0b000000000000000010000000000000,
+        0b000000000000000001000000000000
+    }
+};
+
+/// Multiplies the given address with the matrix bit by bit.
+constexpr size_t apply_matrix(size_t value, const size_t (&mtx)[MTX_SIZE]) {
+  size_t res = 0;
+  for (size_t i = 0; i < MTX_SIZE; ++i) {
+    res <<= 1ULL;
+    res |= (size_t) __builtin_parityl(value & mtx[i]);
+  }
+  return res;
+}
+
+constexpr MemConfigLookupTables build_lookup_tables(const MemConfiguration &cfg) {
+  MemConfigLookupTables tables{};
+  for (size_t slice = 0; slice < MTX_LUT_SLICES; ++slice) {
+    for (size_t byte = 0; byte < 256; ++byte) {
+      tables.DRAM_LUT[slice][byte] = apply_matrix(byte << (8*slice), cfg.DRAM_MTX);
+      tables.ADDR_LUT[slice][byte] = apply_matrix(byte << (8*slice), cfg.ADDR_MTX);
+    }
+  }
+  return tables;
+}
+
+/// The lookup tables of each memory configuration, computed at compile time.
+template<const MemConfiguration &CFG>
+struct ConfigLookupTables {
+  static constexpr MemConfigLookupTables value = build_lookup_tables(CFG);
+};
+
+inline size_t apply_lookup_table(size_t value, const size_t (&lut)[MTX_LUT_SLICES][256]) {
+  value &= (1UL << MTX_SIZE) - 1;
+  size_t res = 0;
+  for (size_t i = 0; i < MTX_LUT_SLICES; ++i) {
+    res ^= lut[i][(value >> (8*i)) & 0xFFUL];
+  }
+  return res;
+}
+
+constexpr size_t AVX2_LANES = sizeof(__m256i)/sizeof(size_t);
+
+/// Same as apply_lookup_table but translates AVX2_LANES values at once using 64-bit gathers.
+__attribute__((target("avx2")))
+void apply_lookup_table_avx2(const size_t *in, size_t *out, const size_t (&lut)[MTX_LUT_SLICES][256]) {
+  const __m256i addr_mask = _mm256_set1_epi64x(static_cast<long long>((1UL << MTX_SIZE) - 1));
+  const __m256i byte_mask = _mm256_set1_epi64x(0xFF);
+  const __m256i value = _mm256_and_si256(_mm256_loadu_si256((const __m256i *) in), addr_mask);
+  __m256i res = _mm256_setzero_si256();
+  for (size_t slice = 0; slice < MTX_LUT_SLICES; ++slice) {
+    const __m256i idx = _mm256_and_si256(_mm256_srli_epi64(value, static_cast<int>(8*slice)), byte_mask);
+    res = _mm256_xor_si256(res, _mm256_i64gather_epi64((const long long *) lut[slice], idx, sizeof(size_t)));
+  }
+  _mm256_storeu_si256((__m256i *) out, res);
+}
+
+/// the lookup tables of a memory configuration that is only known at runtime (e.g., reverse-engineered functions)
+MemConfigLookupTables RuntimeLookupTables;
+
+bool same_matrices(const MemConfiguration &a, const MemConfiguration &b) {
+  return a.BK_SHIFT==b.BK_SHIFT && a.BK_MASK==b.BK_MASK && a.ROW_SHIFT==b.ROW_SHIFT && a.ROW_MASK==b.ROW_MASK
+      && a.COL_SHIFT==b.COL_SHIFT && a.COL_MASK==b.COL_MASK
+      && std::equal(std::begin(a.DRAM_MTX), std::end(a.DRAM_MTX), std::begin(b.DRAM_MTX))
+      && std::equal(std::begin(a.ADDR_MTX), std::end(a.ADDR_MTX), std::begin(b.ADDR_MTX));
+}
+
+}
 
 // initialize static variable
 std::map<size_t, MemConfiguration> DRAMAddr::Configs;
+const MemConfigLookupTables *DRAMAddr::LookupTables = &ConfigLookupTables<SINGLE_RANK_CONFIG>::value;
+DRAMAddr::from_virt_fn DRAMAddr::from_virt_impl =
+    DRAMAddr::from_virt_cfg<SINGLE_RANK_CONFIG, ConfigLookupTables<SINGLE_RANK_CONFIG>::value, false>;
+DRAMAddr::to_virt_fn DRAMAddr::to_virt_impl =
+    DRAMAddr::to_virt_cfg<SINGLE_RANK_CONFIG, ConfigLookupTables<SINGLE_RANK_CONFIG>::value, false>;
 
-void DRAMAddr::initialize(uint64_t num_bank_rank_functions, volatile char *start_address) {
+void DRAMAddr::initialize(uint64_t num_bank_rank_functions, volatile char *start_address, size_t num_superpages) {
   // TODO: This is a shortcut to check if it's a single rank dimm or dual rank in order to load the right memory
   //  configuration. We should get these infos from dmidecode to do it properly, but for now this is easier.
   size_t num_ranks;
@@ -16,19 +245,285 @@ void DRAMAddr::initialize(uint64_t num_bank_rank_functions, volatile char *start
     Logger::log_error("Could not initialize DRAMAddr as #ranks seems not to be 1 or 2.");
     exit(1);
   }
-  DRAMAddr::load_mem_config((CHANS(CHANNEL) | DIMMS(DIMM) | num_ranks | BANKS(NUM_BANKS)));
+  DRAMAddr::initialize_configs();
+  DRAMAddr::initialize(Configs.at(CHANS(CHANNEL) | DIMMS(DIMM) | num_ranks | BANKS(NUM_BANKS)), start_address,
+      num_superpages);
+}
+
+void DRAMAddr::initialize(const MemConfiguration &cfg, volatile char *start_address, size_t num_superpages) {
+  DRAMAddr::set_mem_config(cfg);
   DRAMAddr::set_base_msb((void *) start_address);
+  DRAMAddr::set_num_superpages(num_superpages);
+  if (!DRAMAddr::check_lookup_tables()) {
+    Logger::log_error("Cannot continue with inconsistent address translation lookup tables.");
+    exit(EXIT_FAILURE);
+  }
 }
 
 void DRAMAddr::set_base_msb(void *buff) {
   base_msb = (size_t) buff & (~((size_t) (1ULL << 30UL) - 1UL));  // get higher order bits above the super page
 }
 
-// TODO we can create a DRAMconfig class to load the right matrix depending on
-// the configuration. You could also test it by checking if you can trigger bank conflcits
+void DRAMAddr::set_num_superpages(size_t num) {
+  num_superpages = std::max<size_t>(1, num);
+}
+
 void DRAMAddr::load_mem_config(mem_config_t cfg) {
   DRAMAddr::initialize_configs();
-  MemConfig = Configs[cfg];
+  if (Configs.count(cfg)==0) {
+    Logger::log_error(format_string("There is no memory configuration with identifier %zu.", cfg));
+    exit(EXIT_FAILURE);
+  }
+  set_mem_config(Configs[cfg]);
+}
+
+void DRAMAddr::set_mem_config(const MemConfiguration &cfg) {
+  MemConfig = cfg;
+
+  // choose the translation functions instantiated for this configuration once, so that later translations do not
+  // need to load the configuration from memory; configurations that are only known at runtime use the generic
+  // instantiation that reads the configuration from MemConfig
+  __builtin_cpu_init();
+  const bool avx2 = __builtin_cpu_supports("avx2");
+  if (same_matrices(cfg, SINGLE_RANK_CONFIG)) {
+    select_translation<SINGLE_RANK_CONFIG, ConfigLookupTables<SINGLE_RANK_CONFIG>::value>(avx2);
+  } else if (same_matrices(cfg, DUAL_RANK_CONFIG)) {
+    select_translation<DUAL_RANK_CONFIG, ConfigLookupTables<DUAL_RANK_CONFIG>::value>(avx2);
+  } else {
+    RuntimeLookupTables = build_lookup_tables(cfg);
+    select_translation<MemConfig, RuntimeLookupTables>(avx2);
+  }
+}
+
+MemConfiguration DRAMAddr::create_mem_config(const std::vector<uint64_t> &bank_rank_functions, uint64_t row_function) {
+  const uint64_t addr_mask = (1UL << MTX_SIZE) - 1;
+  row_function &= addr_mask;
+
+  // each bank function consumes one address bit (its pivot) that is neither a row nor a column bit; we bring the
+  // functions into reduced echelon form to choose pivots such that the bank bits can be inverted
+  std::vector<std::pair<uint64_t, uint64_t>> reduced;  // (reduced function, pivot bit)
+  uint64_t pivots = 0;
+  for (auto fn : bank_rank_functions) {
+    fn &= addr_mask;
+    for (const auto &[r, p] : reduced) {
+      if (fn & p) fn ^= r;
+    }
+    const uint64_t candidates = fn & ~row_function;
+    if (candidates==0) {
+      Logger::log_error("Bank/rank functions are linearly dependent, cannot create memory configuration.");
+      exit(EXIT_FAILURE);
+    }
+    const uint64_t pivot = candidates & -candidates;
+    for (auto &[r, p] : reduced) {
+      if (r & pivot) r ^= fn;
+    }
+    reduced.emplace_back(fn, pivot);
+    pivots |= pivot;
+  }
+
+  const uint64_t col_bits = addr_mask & ~row_function & ~pivots;
+  const auto num_bank_bits = static_cast<size_t>(bank_rank_functions.size());
+  const auto num_row_bits = static_cast<size_t>(__builtin_popcountl(row_function));
+  const auto num_col_bits = static_cast<size_t>(__builtin_popcountl(col_bits));
+
+  MemConfiguration cfg{};
+  const size_t num_ranks = std::max<size_t>(1, (1UL << num_bank_bits)/NUM_BANKS);
+  cfg.IDENTIFIER = CHANS(static_cast<size_t>(CHANNEL)) | DIMMS(static_cast<size_t>(DIMM)) | RANKS(num_ranks)
+      | BANKS(static_cast<size_t>(NUM_BANKS));
+  cfg.BK_SHIFT = num_col_bits + num_row_bits;
+  cfg.BK_MASK = (1UL << num_bank_bits) - 1;
+  cfg.COL_SHIFT = num_row_bits;
+  cfg.COL_MASK = (1UL << num_col_bits) - 1;
+  cfg.ROW_SHIFT = 0;
+  cfg.ROW_MASK = (1UL << num_row_bits) - 1;
+
+  // maps a virtual addr -> DRAM addr: bank | col | row, where the first matrix row yields the most significant bit
+  size_t idx = 0;
+  for (const auto &fn : bank_rank_functions) cfg.DRAM_MTX[idx++] = fn & addr_mask;
+  for (int bit = MTX_SIZE - 1; bit >= 0; --bit) {
+    if (col_bits & (1UL << bit)) cfg.DRAM_MTX[idx++] = (1UL << bit);
+  }
+  for (int bit = MTX_SIZE - 1; bit >= 0; --bit) {
+    if (row_function & (1UL << bit)) cfg.DRAM_MTX[idx++] = (1UL << bit);
+  }
+
+  // ADDR_MTX is the inverse of DRAM_MTX, which we compute by Gauss-Jordan elimination over GF(2): rows[i] holds the
+  // address bits that yield the DRAM addr bit inverse[i] refers to
+  size_t rows[MTX_SIZE];
+  size_t inverse[MTX_SIZE];
+  for (size_t i = 0; i < MTX_SIZE; ++i) {
+    rows[i] = cfg.DRAM_MTX[i];
+    inverse[i] = (1UL << (MTX_SIZE - 1 - i));
+  }
+  for (size_t i = 0; i < MTX_SIZE; ++i) {
+    const size_t bit = (1UL << (MTX_SIZE - 1 - i));
+    size_t pivot_row = i;
+    while (pivot_row < MTX_SIZE && !(rows[pivot_row] & bit)) pivot_row++;
+    if (pivot_row==MTX_SIZE) {
+      Logger::log_error("Bank/rank, row, and column functions do not form an invertible mapping.");
+      exit(EXIT_FAILURE);
+    }
+    std::swap(rows[i], rows[pivot_row]);
+    std::swap(inverse[i], inverse[pivot_row]);
+    for (size_t j = 0; j < MTX_SIZE; ++j) {
+      if (j!=i && (rows[j] & bit)) {
+        rows[j] ^= rows[i];
+        inverse[j] ^= inverse[i];
+      }
+    }
+  }
+  std::copy(std::begin(inverse), std::end(inverse), std::begin(cfg.ADDR_MTX));
+  return cfg;
+}
+
+template<const MemConfiguration &CFG, const MemConfigLookupTables &LUT>
+void DRAMAddr::select_translation(bool avx2) {
+  LookupTables = &LUT;
+  from_virt_impl = avx2 ? from_virt_cfg<CFG, LUT, true> : from_virt_cfg<CFG, LUT, false>;
+  to_virt_impl = avx2 ? to_virt_cfg<CFG, LUT, true> : to_virt_cfg<CFG, LUT, false>;
+}
+
+template<const MemConfiguration &CFG, const MemConfigLookupTables &LUT, bool AVX2>
+void DRAMAddr::from_virt_cfg(const size_t *virt_addrs, DRAMAddr *dram_addrs, size_t count) {
+  const auto &lut = LUT.DRAM_LUT;
+  const size_t ROW_BITS = __builtin_popcountl(CFG.ROW_MASK);
+  // the rows of the i-th superpage follow the rows of the (i-1)-th superpage
+  auto decode = [ROW_BITS](size_t virt_addr, size_t res) -> DRAMAddr {
+    const size_t superpage = (virt_addr >= base_msb) ? ((virt_addr - base_msb) >> MTX_SIZE) : 0;
+    return {(res >> CFG.BK_SHIFT) & CFG.BK_MASK,
+            ((res >> CFG.ROW_SHIFT) & CFG.ROW_MASK) | (superpage << ROW_BITS),
+            (res >> CFG.COL_SHIFT) & CFG.COL_MASK};
+  };
+
+  size_t i = 0;
+  if constexpr (AVX2) {
+    size_t res[AVX2_LANES];
+    for (; i + AVX2_LANES <= count; i += AVX2_LANES) {
+      apply_lookup_table_avx2(virt_addrs + i, res, lut);
+      for (size_t j = 0; j < AVX2_LANES; ++j) dram_addrs[i + j] = decode(virt_addrs[i + j], res[j]);
+    }
+  }
+  for (; i < count; ++i) dram_addrs[i] = decode(virt_addrs[i], apply_lookup_table(virt_addrs[i], lut));
+}
+
+template<const MemConfiguration &CFG, const MemConfigLookupTables &LUT, bool AVX2>
+void DRAMAddr::to_virt_cfg(const DRAMAddr *dram_addrs, size_t *virt_addrs, size_t count) {
+  const auto &lut = LUT.ADDR_LUT;
+  const size_t ROW_BITS = __builtin_popcountl(CFG.ROW_MASK);
+  auto linearize = [](const DRAMAddr &addr) -> size_t {
+    return (addr.bank << CFG.BK_SHIFT) | ((addr.row & CFG.ROW_MASK) << CFG.ROW_SHIFT) | (addr.col << CFG.COL_SHIFT);
+  };
+  // wrap out-of-range superpage indices so that we never translate to an address beyond the allocated memory
+  auto superpage_base = [ROW_BITS](const DRAMAddr &addr) -> size_t {
+    return base_msb + (((addr.row >> ROW_BITS)%num_superpages) << MTX_SIZE);
+  };
+
+  size_t i = 0;
+  if constexpr (AVX2) {
+    size_t values[AVX2_LANES];
+    for (; i + AVX2_LANES <= count; i += AVX2_LANES) {
+      for (size_t j = 0; j < AVX2_LANES; ++j) values[j] = linearize(dram_addrs[i + j]);
+      apply_lookup_table_avx2(values, virt_addrs + i, lut);
+      for (size_t j = 0; j < AVX2_LANES; ++j) virt_addrs[i + j] |= superpage_base(dram_addrs[i + j]);
+    }
+  }
+  for (; i < count; ++i) {
+    virt_addrs[i] = superpage_base(dram_addrs[i]) | apply_lookup_table(linearize(dram_addrs[i]), lut);
+  }
+}
+
+void DRAMAddr::to_virt(const std::vector<DRAMAddr> &dram_addrs, std::vector<volatile char *> &virt_addrs) {
+  std::vector<size_t> values(dram_addrs.size());
+  to_virt_impl(dram_addrs.data(), values.data(), values.size());
+  virt_addrs.reserve(virt_addrs.size() + values.size());
+  for (const auto &v : values) virt_addrs.push_back((volatile char *) v);
+}
+
+void DRAMAddr::from_virt(const std::vector<volatile char *> &virt_addrs, std::vector<DRAMAddr> &dram_addrs) {
+  std::vector<size_t> values;
+  values.reserve(virt_addrs.size());
+  for (const auto &addr : virt_addrs) values.push_back((size_t) addr);
+  const auto offset = dram_addrs.size();
+  dram_addrs.resize(offset + values.size());
+  from_virt_impl(values.data(), dram_addrs.data() + offset, values.size());
+}
+
+bool DRAMAddr::check_lookup_tables() {
+  size_t num_mismatches = 0;
+  for (size_t bit = 0; bit < MTX_SIZE; ++bit) {
+    const size_t addr = (1UL << bit);
+    num_mismatches += (apply_lookup_table(addr, LookupTables->DRAM_LUT)!=apply_matrix(addr, MemConfig.DRAM_MTX));
+    num_mismatches += (apply_lookup_table(addr, LookupTables->ADDR_LUT)!=apply_matrix(addr, MemConfig.ADDR_MTX));
+    num_mismatches += (apply_lookup_table(apply_lookup_table(addr, LookupTables->DRAM_LUT), LookupTables->ADDR_LUT)
+        !=addr);
+  }
+  if (num_mismatches > 0) {
+    Logger::log_error(format_string("Address translation lookup tables are inconsistent (%zu mismatches).",
+        num_mismatches));
+    return false;
+  }
+  return true;
+}
+
+bool DRAMAddr::benchmark_lookup_tables(size_t num_samples) {
+  std::mt19937 gen(std::random_device{}());
+  std::uniform_int_distribution<size_t> dist(0, (num_superpages << MTX_SIZE) - 1);
+  std::vector<size_t> samples(num_samples);
+  for (auto &s : samples) s = base_msb + dist(gen);
+
+  size_t num_mismatches = 0;
+  std::vector<size_t> round_trip_mtx(samples.size());
+  auto start_ts = get_timestamp_us();
+  for (size_t i = 0; i < samples.size(); ++i) {
+    round_trip_mtx[i] = (samples[i] & ~((1UL << MTX_SIZE) - 1))
+        | apply_matrix(apply_matrix(samples[i], MemConfig.DRAM_MTX), MemConfig.ADDR_MTX);
+  }
+  const auto elapsed_mtx_us = std::max<int64_t>(1, get_timestamp_us() - start_ts);
+
+  std::vector<DRAMAddr> dram_addrs(samples.size());
+  std::vector<size_t> round_trip_lut(samples.size());
+  start_ts = get_timestamp_us();
+  from_virt_impl(samples.data(), dram_addrs.data(), samples.size());
+  to_virt_impl(dram_addrs.data(), round_trip_lut.data(), samples.size());
+  const auto elapsed_lut_us = std::max<int64_t>(1, get_timestamp_us() - start_ts);
+
+  for (size_t i = 0; i < samples.size(); ++i) {
+    num_mismatches += (round_trip_lut[i]!=samples[i]) + (round_trip_mtx[i]!=samples[i]);
+    const auto res = apply_matrix(samples[i], MemConfig.DRAM_MTX);
+    num_mismatches += (dram_addrs[i].bank!=((res >> MemConfig.BK_SHIFT) & MemConfig.BK_MASK));
+    num_mismatches += ((dram_addrs[i].row & MemConfig.ROW_MASK)!=((res >> MemConfig.ROW_SHIFT) & MemConfig.ROW_MASK));
+    num_mismatches += (dram_addrs[i].col!=((res >> MemConfig.COL_SHIFT) & MemConfig.COL_MASK));
+  }
+
+  Logger::log_info(format_string("Address translation round trips: bit-wise %.1f ns, lookup table %.1f ns.",
+      static_cast<double>(elapsed_mtx_us)*1000.0/static_cast<double>(std::max<size_t>(1, num_samples)),
+      static_cast<double>(elapsed_lut_us)*1000.0/static_cast<double>(std::max<size_t>(1, num_samples))));
+  if (num_mismatches > 0) {
+    Logger::log_error(format_string("Address translation round trips failed for %zu of %zu addresses.",
+        num_mismatches, num_samples));
+    return false;
+  }
+  return true;
+}
+
+size_t DRAMAddr::get_num_columns() {
+  return MemConfig.COL_MASK + 1;
+}
+
+size_t DRAMAddr::get_num_rows() {
+  return (MemConfig.ROW_MASK + 1)*num_superpages;
+}
+
+size_t DRAMAddr::get_num_rows_per_superpage() {
+  return MemConfig.ROW_MASK + 1;
+}
+
+size_t DRAMAddr::shift_row(size_t row, long offset) {
+  const auto rows_per_superpage = get_num_rows_per_superpage();
+  const auto num_rows = static_cast<long>(rows_per_superpage);
+  auto shifted = (static_cast<long>(row%rows_per_superpage) + offset%num_rows)%num_rows;
+  if (shifted < 0) shifted += num_rows;
+  return (row - row%rows_per_superpage) + static_cast<size_t>(shifted);
 }
 
 DRAMAddr::DRAMAddr() = default;
@@ -41,18 +536,7 @@ DRAMAddr::DRAMAddr(size_t bk, size_t r, size_t c) {
 
 DRAMAddr::DRAMAddr(void *addr) {
   auto p = (size_t) addr;
-  size_t res = 0;
-  for (unsigned long i : MemConfig.DRAM_MTX) {
-    res <<= 1ULL;
-    res |= (size_t) __builtin_parityl(p & i);
-  }
-  bank = (res >> MemConfig.BK_SHIFT) & MemConfig.BK_MASK;
-  row = (res >> MemConfig.ROW_SHIFT) & MemConfig.ROW_MASK;
-  col = (res >> MemConfig.COL_SHIFT) & MemConfig.COL_MASK;
-}
-
-size_t DRAMAddr::linearize() const {
-  return (this->bank << MemConfig.BK_SHIFT) | (this->row << MemConfig.ROW_SHIFT) | (this->col << MemConfig.COL_SHIFT);
+  from_virt_impl(&p, this, 1);
 }
 
 void *DRAMAddr::to_virt() {
@@ -60,14 +544,9 @@ void *DRAMAddr::to_virt() {
 }
 
 void *DRAMAddr::to_virt() const {
-  size_t res = 0;
-  size_t l = this->linearize();
-  for (unsigned long i : MemConfig.ADDR_MTX) {
-    res <<= 1ULL;
-    res |= (size_t) __builtin_parityl(l & i);
-  }
-  void *v_addr = (void *) (base_msb | res);
-  return v_addr;
+  size_t v_addr;
+  to_virt_impl(this, &v_addr, 1);
+  return (void *) v_addr;
 }
 
 std::string DRAMAddr::to_string() {
@@ -100,183 +579,27 @@ void DRAMAddr::add_inplace(size_t bank_increment, size_t row_increment, size_t c
 }
 
 // Define the static DRAM configs
-MemConfiguration DRAMAddr::MemConfig;
+MemConfiguration DRAMAddr::MemConfig = SINGLE_RANK_CONFIG;
 size_t DRAMAddr::base_msb;
+size_t DRAMAddr::num_superpages = 1;
 
 #ifdef ENABLE_JSON
 
 nlohmann::json DRAMAddr::get_memcfg_json() {
-  std::map<size_t, nlohmann::json> memcfg_to_json = {
-      {(CHANS(1UL) | DIMMS(1UL) | RANKS(1UL) | BANKS(16UL)),
-       nlohmann::json{
-           {"channels", 1},
-           {"dimms", 1},
-           {"ranks", 1},
-           {"banks", 16}}},
-      {(CHANS(1UL) | DIMMS(1UL) | RANKS(2UL) | BANKS(16UL)),
-       nlohmann::json{
-           {"channels", 1},
-           {"dimms", 1},
-           {"ranks", 2},
-           {"banks", 16}}}
-  };
-  return memcfg_to_json[MemConfig.IDENTIFIER];
+  return nlohmann::json{
+      {"channels", (MemConfig.IDENTIFIER >> (8UL*3UL)) & 0xFFUL},
+      {"dimms", (MemConfig.IDENTIFIER >> (8UL*2UL)) & 0xFFUL},
+      {"ranks", (MemConfig.IDENTIFIER >> (8UL*1UL)) & 0xFFUL},
+      {"banks", (MemConfig.IDENTIFIER >> (8UL*0UL)) & 0xFFUL},
+      {"superpages", num_superpages}};
 }
 
 #endif
 
 void DRAMAddr::initialize_configs() {
-  struct MemConfiguration single_rank = {
-      .IDENTIFIER = (CHANS(1UL) | DIMMS(1UL) | RANKS(1UL) | BANKS(16UL)),
-      .BK_SHIFT =  26,
-      .BK_MASK =  (0b1111),
-      .ROW_SHIFT =  0,
-      .ROW_MASK =  (0b1111111111111),
-      .COL_SHIFT =  13,
-      .COL_MASK =  (0b1111111111111),
-      /* maps a virtual addr -> DRAM addr: bank (4 bits) | col (13 bits) | row (13 bits) */
-      .DRAM_MTX =  {
-          0b000000000000000010000001000000, /* 0x02040 bank b3 = addr b6 + b13 */
-          0b000000000000100100000000000000, /* 0x24000 bank b2 = addr b14 + b17 */
-          0b000000000001001000000000000000, /* 0x48000 bank b1 = addr b15 + b18 */
-          0b000000000010010000000000000000, /* 0x90000 bank b0 = addr b16 + b19 */
-          0b000000000000000010000000000000, /* col b12 = addr b13 */
-          0b000000000000000001000000000000, /* col b11 = addr b12 */
-          0b000000000000000000100000000000, /* col b10 = addr b11 */
-          0b000000000000000000010000000000, /* col b9 = addr b10 */
-          0b000000000000000000001000000000, /* col b8 = addr b9 */
-          0b000000000000000000000100000000, /* col b7 = addr b8*/
-          0b000000000000000000000010000000, /* col b6 = addr b7 */
-          0b000000000000000000000000100000, /* col b5 = addr b5 */
-          0b000000000000000000000000010000, /* col b4 = addr b4*/
-          0b000000000000000000000000001000, /* col b3 = addr b3 */
-          0b000000000000000000000000000100, /* col b2 = addr b2 */
-          0b000000000000000000000000000010, /* col b1 = addr b1 */
-          0b000000000000000000000000000001, /* col b0 = addr b0*/
-          0b100000000000000000000000000000, /* row b12 = addr b29 */
-          0b010000000000000000000000000000, /* row b11 = addr b28 */
-          0b001000000000000000000000000000, /* row b10 = addr b27 */
-          0b000100000000000000000000000000, /* row b9 = addr b26 */
-          0b000010000000000000000000000000, /* row b8 = addr b25 */
-          0b000001000000000000000000000000, /* row b7 = addr b24 */
-          0b000000100000000000000000000000, /* row b6 = addr b23 */
-          0b000000010000000000000000000000, /* row b5 = addr b22 */
-          0b000000001000000000000000000000, /* row b4 = addr b21 */
-          0b000000000100000000000000000000, /* row b3 = addr b20 */
-          0b000000000010000000000000000000, /* row b2 = addr b19 */
-          0b000000000001000000000000000000, /* row b1 = addr b18 */
-          0b000000000000100000000000000000, /* row b0 = addr b17 */
-          },
-      /* maps a DRAM addr (bank | col | row) --> virtual addr */
-      .ADDR_MTX =  {
-          0b000000000000000001000000000000, /* addr b29 = row b12 */
-          0b000000000000000000100000000000, /* addr b28 = row b11 */
-          0b000000000000000000010000000000, /* addr b27 = row b10 */
-          0b000000000000000000001000000000, /* addr b26 = row b9 */
-          0b000000000000000000000100000000, /* addr b25 = row b8 */
-          0b000000000000000000000010000000, /* addr b24 = row b7 */
-          0b000000000000000000000001000000, /* addr b23 = row b6 */
-          0b000000000000000000000000100000, /* addr b22 = row b5 */
-          0b000000000000000000000000010000, /* addr b21 = row b4 */
-          0b000000000000000000000000001000, /* addr b20 = row b3 */
-          0b000000000000000000000000000100, /* addr b19 = row b2 */
-          0b000000000000000000000000000010, /* addr b18 = row b1 */
-          0b000000000000000000000000000001, /* addr b17 = row b0 */
-          0b000100000000000000000000000100, /* addr b16 = bank b0 + row b2 (addr b19) */
-          0b001000000000000000000000000010, /* addr b15 = bank b1 + row b1 (addr b18) */
-          0b010000000000000000000000000001, /* addr b14 = bank b2 + row b0 (addr b17) */
-          0b000010000000000000000000000000, /* addr b13 = col b12 */
-          0b000001000000000000000000000000, /* addr b12 = col b11 */
-          0b000000100000000000000000000000, /* addr b11 = col b10 */
-          0b000000010000000000000000000000, /* addr b10 = col b9 */
-          0b000000001000000000000000000000, /* addr b9 = col b8 */
-          0b000000000100000000000000000000, /* addr b8 = col b7 */
-          0b000000000010000000000000000000, /* addr b7 = col b6 */
-          0b100010000000000000000000000000, /* addr b6 = bank b3 + col b12 (addr b13)*/
-          0b000000000001000000000000000000, /* addr b5 = col b5 */
-          0b000000000000100000000000000000, /* addr b4 = col b4 */
-          0b000000000000010000000000000000, /* addr b3 = col b3 */
-          0b000000000000001000000000000000, /* addr b2 = col b2 */
-          0b000000000000000100000000000000, /* addr b1 = col b1 */
-          0b000000000000000010000000000000  /* addr b0 = col b0 */
-      }
-  };
-  struct MemConfiguration dual_rank = {
-      .IDENTIFIER = (CHANS(1UL) | DIMMS(1UL) | RANKS(2UL) | BANKS(16UL)),
-      .BK_SHIFT =  25,
-      .BK_MASK =  (0b11111),
-      .ROW_SHIFT =  0,
-      .ROW_MASK =  (0b111111111111),
-      .COL_SHIFT =  12,
-      .COL_MASK =  (0b1111111111111),
-      .DRAM_MTX =  {
-          0b000000000000000010000001000000,
-          0b000000000001000100000000000000,
-          0b000000000010001000000000000000,
-          0b000000000100010000000000000000,
-          0b000000001000100000000000000000,
-          0b000000000000000010000000000000,
-          0b000000000000000001000000000000,
-          0b000000000000000000100000000000,
-          0b000000000000000000010000000000,
-          0b000000000000000000001000000000,
-          0b000000000000000000000100000000,
-          0b000000000000000000000010000000,
-          0b000000000000000000000000100000,
-          0b000000000000000000000000010000,
-          0b000000000000000000000000001000,
-          0b000000000000000000000000000100,
-          0b000000000000000000000000000010,
-          0b000000000000000000000000000001,
-          0b100000000000000000000000000000,
-          0b010000000000000000000000000000,
-          0b001000000000000000000000000000,
-          0b000100000000000000000000000000,
-          0b000010000000000000000000000000,
-          0b000001000000000000000000000000,
-          0b000000100000000000000000000000,
-          0b000000010000000000000000000000,
-          0b000000001000000000000000000000,
-          0b000000000100000000000000000000,
-          0b000000000010000000000000000000,
-          0b000000000001000000000000000000
-      },
-      .ADDR_MTX =  {
-          0b000000000000000000100000000000,
-          0b000000000000000000010000000000,
-          0b000000000000000000001000000000,
-          0b000000000000000000000100000000,
-          0b000000000000000000000010000000,
-          0b000000000000000000000001000000,
-          0b000000000000000000000000100000,
-          0b000000000000000000000000010000,
-          0b000000000000000000000000001000,
-          0b000000000000000000000000000100,
-          0b000000000000000000000000000010,
-          0b000000000000000000000000000001,
-          0b000010000000000000000000001000,
-          0b000100000000000000000000000100,
-          0b001000000000000000000000000010,
-          0b010000000000000000000000000001,
-          0b000001000000000000000000000000,
-          0b000000100000000000000000000000,
-          0b000000010000000000000000000000,
-          0b000000001000000000000000000000,
-          0b000000000100000000000000000000,
-          0b000000000010000000000000000000,
-          0b000000000001000000000000000000,
-          0b100001000000000000000000000000,
-          0b000000000000100000000000000000,
-          0b000000000000010000000000000000,
-          0b000000000000001000000000000000,
-          0b000000000000000100000000000000,
-          0b000000000000000010000000000000,
-          0b000000000000000001000000000000
-      }
-  };
   DRAMAddr::Configs = {
-      {(CHANS(1UL) | DIMMS(1UL) | RANKS(1UL) | BANKS(16UL)), single_rank},
-      {(CHANS(1UL) | DIMMS(1UL) | RANKS(2UL) | BANKS(16UL)), dual_rank}
+      {SINGLE_RANK_CONFIG.IDENTIFIER, SINGLE_RANK_CONFIG},
+      {DUAL_RANK_CONFIG.IDENTIFIER, DUAL_RANK_CONFIG}
   };
 }
 
@@ -0,0 +1,201 @@
+#include "Memory/DataPatternKernel.hpp"
+
+#include <algorithm>
+#include <immintrin.h>
+
+// initialize static variables
+DataPatternKernel::find_mismatch_fn DataPatternKernel::find_mismatch_impl = DataPatternKernel::find_mismatch_scalar;
+DataPatternKernel::fill_fn DataPatternKernel::fill_non_temporal_impl = DataPatternKernel::fill_non_temporal_scalar;
+std::string DataPatternKernel::impl_name = "scalar"; /* NOLINT */
+DATA_PATTERN DataPatternKernel::data_pattern = DATA_PATTERN::RANDOM;
+uint32_t DataPatternKernel::seed = 0x2000;
+
+void DataPatternKernel::initialize() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    find_mismatch_impl = find_mismatch_avx512;
+    fill_non_temporal_impl = fill_non_temporal_avx512;
+    impl_name = "AVX-512";
+  } else if (__builtin_cpu_supports("avx2")) {
+    find_mismatch_impl = find_mismatch_avx2;
+    fill_non_temporal_impl = fill_non_temporal_avx2;
+    impl_name = "AVX2";
+  } else {
+    find_mismatch_impl = find_mismatch_scalar;
+    fill_non_temporal_impl = fill_non_temporal_scalar;
+    impl_name = "scalar";
+  }
+}
+
+void DataPatternKernel::set_data_pattern(DATA_PATTERN pattern) {
+  data_pattern = pattern;
+}
+
+void DataPatternKernel::set_seed(uint32_t new_seed) {
+  seed = new_seed;
+}
+
+const std::string &DataPatternKernel::get_impl_name() {
+  return impl_name;
+}
+
+void DataPatternKernel::fill(volatile char *addr, uint64_t offset, size_t len) {
+  for (size_t i = 0; i < len; i += sizeof(uint32_t)) {
+    *((volatile uint32_t *) (addr + i)) = expected_value(offset + i);
+  }
+}
+
+void DataPatternKernel::fill_non_temporal_scalar(volatile char *addr, uint64_t offset, size_t len) {
+  for (size_t i = 0; i < len; i += sizeof(uint32_t)) {
+    _mm_stream_si32((int *) (addr + i), static_cast<int>(expected_value(offset + i)));
+  }
+}
+
+size_t DataPatternKernel::find_mismatch_scalar(const volatile char *addr, uint64_t offset, size_t len) {
+  for (size_t i = 0; i < len; i += sizeof(uint32_t)) {
+    if (*((const volatile uint32_t *) (addr + i))!=expected_value(offset + i)) return i;
+  }
+  return len;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i hash32_avx2(__m256i x) {
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+  x = _mm256_mullo_epi32(x, _mm256_set1_epi32(0x7feb352d));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+  x = _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(0x846ca68bU)));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+  return x;
+}
+
+__attribute__((target("avx2")))
+size_t DataPatternKernel::find_mismatch_avx2(const volatile char *addr, uint64_t offset, size_t len) {
+  constexpr size_t LANES = sizeof(__m256i)/sizeof(uint32_t);
+  const bool random = (data_pattern==DATA_PATTERN::RANDOM);
+  const __m256i lane_idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i step = _mm256_set1_epi32(LANES);
+
+  size_t i = 0;
+  while (i < len) {
+    // the PRNG is keyed per page, therefore we process the range page by page
+    const uint64_t cur_offset = offset + i;
+    const size_t chunk_end = std::min(len, i + (KEY_PAGE_SIZE - cur_offset%KEY_PAGE_SIZE));
+    __m256i counter = _mm256_add_epi32(lane_idx, _mm256_set1_epi32(static_cast<int>(
+        page_key(cur_offset) + static_cast<uint32_t>((cur_offset%KEY_PAGE_SIZE)/sizeof(uint32_t)))));
+    const __m256i constant = _mm256_set1_epi32(static_cast<int>(expected_value(cur_offset)));
+
+    for (; i + sizeof(__m256i) <= chunk_end; i += sizeof(__m256i)) {
+      const __m256i expected = random ? hash32_avx2(counter) : constant;
+      const __m256i actual = _mm256_loadu_si256((const __m256i *) (addr + i));
+      const auto eq_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi32(actual, expected)));
+      if (eq_mask!=0xFFFFFFFFU) return i + static_cast<size_t>(__builtin_ctz(~eq_mask)/sizeof(uint32_t))*sizeof(uint32_t);
+      counter = _mm256_add_epi32(counter, step);
+    }
+
+    // compare any trailing words that do not fill a whole vector register
+    if (i < chunk_end) {
+      auto res = find_mismatch_scalar(addr + i, offset + i, chunk_end - i);
+      if (res < chunk_end - i) return i + res;
+      i = chunk_end;
+    }
+  }
+  return len;
+}
+
+__attribute__((target("avx2")))
+void DataPatternKernel::fill_non_temporal_avx2(volatile char *addr, uint64_t offset, size_t len) {
+  constexpr size_t LANES = sizeof(__m256i)/sizeof(uint32_t);
+  // streaming stores require aligned addresses, fall back to the scalar variant otherwise
+  if (((uint64_t) addr%sizeof(__m256i))!=0 || (offset%sizeof(__m256i))!=0 || (len%sizeof(__m256i))!=0) {
+    fill_non_temporal_scalar(addr, offset, len);
+    return;
+  }
+  const bool random = (data_pattern==DATA_PATTERN::RANDOM);
+  const __m256i lane_idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i step = _mm256_set1_epi32(LANES);
+
+  size_t i = 0;
+  while (i < len) {
+    const uint64_t cur_offset = offset + i;
+    const size_t chunk_end = std::min(len, i + (KEY_PAGE_SIZE - cur_offset%KEY_PAGE_SIZE));
+    __m256i counter = _mm256_add_epi32(lane_idx, _mm256_set1_epi32(static_cast<int>(
+        page_key(cur_offset) + static_cast<uint32_t>((cur_offset%KEY_PAGE_SIZE)/sizeof(uint32_t)))));
+    const __m256i constant = _mm256_set1_epi32(static_cast<int>(expected_value(cur_offset)));
+    for (; i < chunk_end; i += sizeof(__m256i)) {
+      _mm256_stream_si256((__m256i *) (addr + i), random ? hash32_avx2(counter) : constant);
+      counter = _mm256_add_epi32(counter, step);
+    }
+  }
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i hash32_avx512(__m512i x) {
+  x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+  x = _mm512_mullo_epi32(x, _mm512_set1_epi32(0x7feb352d));
+  x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 15));
+  x = _mm512_mullo_epi32(x, _mm512_set1_epi32(static_cast<int>(0x846ca68bU)));
+  x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+  return x;
+}
+
+__attribute__((target("avx512f")))
+size_t DataPatternKernel::find_mismatch_avx512(const volatile char *addr, uint64_t offset, size_t len) {
+  constexpr size_t LANES = sizeof(__m512i)/sizeof(uint32_t);
+  const bool random = (data_pattern==DATA_PATTERN::RANDOM);
+  const __m512i lane_idx = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m512i step = _mm512_set1_epi32(LANES);
+
+  size_t i = 0;
+  while (i < len) {
+    // the PRNG is keyed per page, therefore we process the range page by page
+    const uint64_t cur_offset = offset + i;
+    const size_t chunk_end = std::min(len, i + (KEY_PAGE_SIZE - cur_offset%KEY_PAGE_SIZE));
+    __m512i counter = _mm512_add_epi32(lane_idx, _mm512_set1_epi32(static_cast<int>(
+        page_key(cur_offset) + static_cast<uint32_t>((cur_offset%KEY_PAGE_SIZE)/sizeof(uint32_t)))));
+    const __m512i constant = _mm512_set1_epi32(static_cast<int>(expected_value(cur_offset)));
+
+    // each iteration compares exactly one cache line
+    for (; i + sizeof(__m512i) <= chunk_end; i += sizeof(__m512i)) {
+      const __m512i expected = random ? hash32_avx512(counter) : constant;
+      const __m512i actual = _mm512_loadu_si512((const void *) (addr + i));
+      const auto neq_mask = static_cast<uint32_t>(_mm512_cmpneq_epi32_mask(actual, expected));
+      if (neq_mask!=0) return i + static_cast<size_t>(__builtin_ctz(neq_mask))*sizeof(uint32_t);
+      counter = _mm512_add_epi32(counter, step);
+    }
+
+    // compare any trailing words that do not fill a whole vector register
+    if (i < chunk_end) {
+      auto res = find_mismatch_scalar(addr + i, offset + i, chunk_end - i);
+      if (res < chunk_end - i) return i + res;
+      i = chunk_end;
+    }
+  }
+  return len;
+}
+
+__attribute__((target("avx512f")))
+void DataPatternKernel::fill_non_temporal_avx512(volatile char *addr, uint64_t offset, size_t len) {
+  constexpr size_t LANES = sizeof(__m512i)/sizeof(uint32_t);
+  // streaming stores require aligned addresses, fall back to the scalar variant otherwise
+  if (((uint64_t) addr%sizeof(__m512i))!=0 || (offset%sizeof(__m512i))!=0 || (len%sizeof(__m512i))!=0) {
+    fill_non_temporal_scalar(addr, offset, len);
+    return;
+  }
+  const bool random = (data_pattern==DATA_PATTERN::RANDOM);
+  const __m512i lane_idx = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m512i step = _mm512_set1_epi32(LANES);
+
+  size_t i = 0;
+  while (i < len) {
+    const uint64_t cur_offset = offset + i;
+    const size_t chunk_end = std::min(len, i + (KEY_PAGE_SIZE - cur_offset%KEY_PAGE_SIZE));
+    __m512i counter = _mm512_add_epi32(lane_idx, _mm512_set1_epi32(static_cast<int>(
+        page_key(cur_offset) + static_cast<uint32_t>((cur_offset%KEY_PAGE_SIZE)/sizeof(uint32_t)))));
+    const __m512i constant = _mm512_set1_epi32(static_cast<int>(expected_value(cur_offset)));
+    // each iteration writes exactly one cache line
+    for (; i < chunk_end; i += sizeof(__m512i)) {
+      _mm512_stream_si512((__m512i *) (addr + i), random ? hash32_avx512(counter) : constant);
+      counter = _mm512_add_epi32(counter, step);
+    }
+  }
+}
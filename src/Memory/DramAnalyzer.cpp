@@ -1,77 +1,177 @@
 #include "Memory/DramAnalyzer.hpp"
 
+#include <pthread.h>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <thread>
 #include <unordered_set>
 
+#include "Memory/DRAMAddr.hpp"
+#include "Memory/Memory.hpp"
+#include "Memory/RefTiming.hpp"
+#include "Utilities/TimeHelper.hpp"
+
+#ifdef ENABLE_JSON
+#include <nlohmann/json.hpp>
+#endif
+
+namespace {
+
+// parameters of the sequential probability ratio test in DramAnalyzer::is_conflict: the probability that a sample
+// exceeds the threshold if the addresses conflict (H1) or do not conflict (H0), and the tolerated error rates
+constexpr double SPRT_P_ABOVE_CONFLICT = 0.9;
+constexpr double SPRT_P_ABOVE_NO_CONFLICT = 0.1;
+constexpr double SPRT_ALPHA = 0.01;  // false positive rate
+constexpr double SPRT_BETA = 0.01;   // false negative rate
+
+// the maximum number of samples per test; undecided tests are resolved by the mean access time
+constexpr size_t SPRT_MAX_SAMPLES = (2*DRAMA_ROUNDS)/SPRT_ROUNDS_PER_SAMPLE;
+
+// the maximum number of addresses that did not conflict with any bank yet and are kept to form new banks
+constexpr size_t MAX_BANK_CANDIDATES = 2*NUM_BANKS;
+
+}
+
+bool DramAnalyzer::is_conflict(volatile char *a1, volatile char *a2, size_t &num_rounds) const {
+  static const double llr_above = std::log(SPRT_P_ABOVE_CONFLICT/SPRT_P_ABOVE_NO_CONFLICT);
+  static const double llr_below = std::log((1.0 - SPRT_P_ABOVE_CONFLICT)/(1.0 - SPRT_P_ABOVE_NO_CONFLICT));
+  static const double accept_bound = std::log((1.0 - SPRT_BETA)/SPRT_ALPHA);
+  static const double reject_bound = std::log(SPRT_BETA/(1.0 - SPRT_ALPHA));
+
+  double llr = 0;
+  int64_t sum = 0;
+  size_t num_samples = 0;
+  while (num_samples < SPRT_MAX_SAMPLES) {
+    const int t = measure_time(a1, a2, SPRT_ROUNDS_PER_SAMPLE);
+    num_samples++;
+    sum += t;
+    llr += (t > threshold) ? llr_above : llr_below;
+    if (llr >= accept_bound || llr <= reject_bound) break;
+  }
+  num_rounds += num_samples*SPRT_ROUNDS_PER_SAMPLE;
+  if (llr >= accept_bound) return true;
+  if (llr <= reject_bound) return false;
+  return (sum/static_cast<int64_t>(num_samples)) > threshold;
+}
+
 void DramAnalyzer::find_bank_conflicts() {
+  calibrate_threshold();
+
+  // cluster random addresses into banks in a single pass: an address joins the bank whose first address it conflicts
+  // with, addresses that conflict with no bank are kept as candidates until another address conflicts with them and
+  // both form a new bank
+  const auto start_ts = get_timestamp_us();
+  std::vector<volatile char *> candidates;
+  size_t num_rounds = 0;
+  size_t num_addresses = 0;
   size_t nr_banks_cur = 0;
   int remaining_tries = NUM_BANKS*256;  // experimentally determined, may be unprecise
-  while (nr_banks_cur < NUM_BANKS && remaining_tries > 0) {
-    reset:
-    remaining_tries--;
+  while (nr_banks_cur < NUM_BANKS) {
+    if (remaining_tries--==0) {
+      Logger::log_error(format_string(
+          "Could not find conflicting address sets. Is the number of banks (%d) defined correctly?",
+          (int) NUM_BANKS));
+      exit(1);
+    }
     auto a1 = start_address + (dist(gen)%(MEM_SIZE/64))*64;
-    auto a2 = start_address + (dist(gen)%(MEM_SIZE/64))*64;
-    auto ret1 = measure_time(a1, a2);
-    auto ret2 = measure_time(a1, a2);
-
-    if ((ret1 > THRESH) && (ret2 > THRESH)) {
-      bool all_banks_set = true;
-      for (size_t i = 0; i < NUM_BANKS; i++) {
-        if (banks.at(i).empty()) {
-          all_banks_set = false;
-        } else {
-          auto bank = banks.at(i);
-          ret1 = measure_time(a1, bank[0]);
-          ret2 = measure_time(a2, bank[0]);
-          if ((ret1 > THRESH) || (ret2 > THRESH)) {
-            // possibly noise if only exactly one is true,
-            // i.e., (ret1 > THRESH) or (ret2 > THRESH)
-            goto reset;
-          }
-        }
-      }
+    num_addresses++;
 
-      // stop if we already determined addresses for each bank
-      if (all_banks_set) return;
+    size_t num_matches = 0;
+    size_t matching_bank = 0;
+    for (size_t i = 0; i < nr_banks_cur; i++) {
+      if (is_conflict(a1, banks.at(i).at(0), num_rounds)) {
+        num_matches++;
+        matching_bank = i;
+      }
+    }
+    // an address conflicting with more than one bank is a sign of noise
+    if (num_matches > 1) continue;
+    if (num_matches==1) {
+      if (banks.at(matching_bank).size() < NUM_TARGETS) banks.at(matching_bank).push_back(a1);
+      continue;
+    }
 
+    auto it = std::find_if(candidates.begin(), candidates.end(), [&](volatile char *candidate) {
+      return is_conflict(a1, candidate, num_rounds);
+    });
+    if (it!=candidates.end()) {
       // store addresses found for each bank
       assert(banks.at(nr_banks_cur).empty() && "Bank not empty");
+      banks.at(nr_banks_cur).push_back(*it);
       banks.at(nr_banks_cur).push_back(a1);
-      banks.at(nr_banks_cur).push_back(a2);
       nr_banks_cur++;
+      candidates.erase(it);
+    } else {
+      if (candidates.size()==MAX_BANK_CANDIDATES) candidates.erase(candidates.begin());
+      candidates.push_back(a1);
     }
-    if (remaining_tries==0) {
-      Logger::log_error(format_string(
-          "Could not find conflicting address sets. Is the number of banks (%d) defined correctly?",
-          (int) NUM_BANKS));
-      exit(1);
-    }
   }
+  Logger::log_info(format_string("Found bank conflicts in %.2f ms (%zu addresses, %.0f measurement rounds each).",
+      static_cast<double>(get_timestamp_us() - start_ts)/1000.0, num_addresses,
+      static_cast<double>(num_rounds)/static_cast<double>(num_addresses)));
+
+  // populate the banks in parallel, each worker on its own core of the local NUMA node
+  const auto targets_start_ts = get_timestamp_us();
+  const auto cpus = Memory::get_numa_local_cpus();
+  const size_t num_workers = std::max<size_t>(1, std::min<size_t>(banks.size(), cpus.size()));
+  std::vector<size_t> worker_rounds(num_workers, 0);
+  std::vector<std::thread> workers;
+  for (size_t w = 0; w < num_workers; ++w) {
+    const auto seed = static_cast<std::mt19937::result_type>(gen());
+    const int cpu = cpus.empty() ? -1 : cpus.at(w%cpus.size());
+    workers.emplace_back([this, w, num_workers, seed, cpu, &worker_rounds]() {
+      // pin the worker before its first measurement so that it never measures on another worker's core
+      if (cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+      }
+      std::mt19937 worker_gen(seed);
+      for (size_t i = w; i < banks.size(); i += num_workers) find_targets(banks.at(i), worker_gen, worker_rounds.at(w));
+    });
+  }
+  for (auto &w : workers) w.join();
+  size_t num_target_rounds = 0;
+  for (const auto &r : worker_rounds) num_target_rounds += r;
+  Logger::log_info(format_string("Populated addresses from different banks in %.2f ms using %zu threads "
+                                 "(%zu measurement rounds).",
+      static_cast<double>(get_timestamp_us() - targets_start_ts)/1000.0, num_workers, num_target_rounds));
 
-  Logger::log_info("Found bank conflicts.");
+  // the workers' concurrent measurements disturb each other and can yield false conflicts, hence we re-validate each
+  // address found by the workers serially and replace the ones that do not conflict with their bank anymore
+  const auto validation_start_ts = get_timestamp_us();
+  size_t num_validation_rounds = 0;
+  size_t num_removed = 0;
   for (auto &bank : banks) {
-    find_targets(bank);
+    // the first two addresses were found serially and are the reference of the bank
+    auto first = bank.at(0);
+    auto second = bank.at(1);
+    auto new_end = std::remove_if(bank.begin() + 2, bank.end(), [&](volatile char *addr) {
+      return !is_conflict(addr, first, num_validation_rounds) || !is_conflict(addr, second, num_validation_rounds);
+    });
+    num_removed += static_cast<size_t>(std::distance(new_end, bank.end()));
+    bank.erase(new_end, bank.end());
+    find_targets(bank, gen, num_validation_rounds);
   }
-  Logger::log_info("Populated addresses from different banks.");
+  Logger::log_info(format_string("Re-validated the bank addresses serially in %.2f ms, replaced %zu of %zu addresses "
+                                 "(%zu measurement rounds).",
+      static_cast<double>(get_timestamp_us() - validation_start_ts)/1000.0, num_removed,
+      banks.size()*(NUM_TARGETS - 2), num_validation_rounds));
 }
 
-void DramAnalyzer::find_targets(std::vector<volatile char *> &target_bank) {
+void DramAnalyzer::find_targets(std::vector<volatile char *> &target_bank, std::mt19937 &rng, size_t &num_rounds) {
   // create an unordered set of the addresses in the target bank for a quick lookup
-  // std::unordered_set<volatile char*> tmp; tmp.insert(target_bank.begin(), target_bank.end());
   std::unordered_set<volatile char *> tmp(target_bank.begin(), target_bank.end());
-  target_bank.clear();
-  size_t num_repetitions = 5;
-  while (tmp.size() < 10) {
-    auto a1 = start_address + (dist(gen)%(MEM_SIZE/64))*64;
+  auto local_dist = dist;
+  while (target_bank.size() < NUM_TARGETS) {
+    auto a1 = start_address + (local_dist(rng)%(MEM_SIZE/64))*64;
     if (tmp.count(a1) > 0) continue;
-    uint64_t cumulative_times = 0;
-    for (size_t i = 0; i < num_repetitions; i++) {
-      for (const auto &addr : tmp) {
-        cumulative_times += measure_time(a1, addr);
-      }
-    }
-    cumulative_times /= num_repetitions;
-    if ((cumulative_times/tmp.size()) > THRESH) {
+    // require a conflict with two of the bank's addresses to not add an address because of a single noisy decision
+    if (is_conflict(a1, target_bank.front(), num_rounds) && is_conflict(a1, target_bank.back(), num_rounds)) {
       tmp.insert(a1);
       target_bank.push_back(a1);
     }
@@ -79,7 +179,7 @@ void DramAnalyzer::find_targets(std::vector<volatile char *> &target_bank) {
 }
 
 DramAnalyzer::DramAnalyzer(volatile char *target) :
-  row_function(0), start_address(target) {
+  row_function(0), start_address(target), threshold(DEFAULT_THRESH), acts_per_trefi(0), ref_threshold(0) {
   std::random_device rd;
   gen = std::mt19937(rd());
   dist = std::uniform_int_distribution<>(0, std::numeric_limits<int>::max());
@@ -90,6 +190,10 @@ std::vector<uint64_t> DramAnalyzer::get_bank_rank_functions() {
   return bank_rank_functions;
 }
 
+uint64_t DramAnalyzer::get_row_function() const {
+  return row_function;
+}
+
 void DramAnalyzer::load_known_functions(int num_ranks) {
   if (num_ranks==1) {
     bank_rank_functions = std::vector<uint64_t>({0x2040, 0x24000, 0x48000, 0x90000});
@@ -112,6 +216,243 @@ void DramAnalyzer::load_known_functions(int num_ranks) {
   Logger::log_data(ss.str());
 }
 
+bool DramAnalyzer::recover_functions() {
+  // bits below the cache line size cannot be observed and the functions do not span beyond a superpage
+  const uint64_t addr_mask = ((1UL << MTX_SIZE) - 1) & ~((uint64_t) CACHELINE_SIZE - 1);
+  const auto num_bank_bits = static_cast<size_t>(__builtin_ctzl(NUM_BANKS));
+
+  // row-reduce the address differences within each bank; a function f must satisfy parity(f & diff) = 0 for every
+  // difference, i.e., the functions span the orthogonal complement of the differences' span
+  std::vector<std::pair<uint64_t, uint64_t>> diff_basis;  // (reduced difference, pivot bit)
+  size_t num_rejected = 0;
+  for (const auto &bank : banks) {
+    for (size_t i = 1; i < bank.size(); ++i) {
+      uint64_t diff = ((uint64_t) (bank[i] - start_address) ^ (uint64_t) (bank[0] - start_address)) & addr_mask;
+      for (const auto &[d, p] : diff_basis) {
+        if (diff & p) diff ^= d;
+      }
+      if (diff==0) continue;
+      // every independent difference removes one dimension of the complement; a misclassified address would leave
+      // fewer functions than we need to tell NUM_BANKS banks apart, so we treat it as measurement noise
+      const size_t num_functions = static_cast<size_t>(__builtin_popcountl(addr_mask)) - diff_basis.size() - 1;
+      if (num_functions < num_bank_bits) {
+        num_rejected++;
+        continue;
+      }
+      const uint64_t pivot = 1UL << (63 - __builtin_clzl(diff));
+      for (auto &[d, p] : diff_basis) {
+        if (d & pivot) d ^= diff;
+      }
+      diff_basis.emplace_back(diff, pivot);
+    }
+  }
+
+  // each non-pivot bit yields one vector of the orthogonal complement: the bit itself plus the pivots of all
+  // differences containing it (the basis is in reduced echelon form, so each pivot occurs in a single difference)
+  uint64_t diff_pivots = 0;
+  for (const auto &[d, p] : diff_basis) diff_pivots |= p;
+  std::vector<uint64_t> complement;
+  for (size_t bit = 0; bit < MTX_SIZE; ++bit) {
+    const uint64_t b = 1UL << bit;
+    if (!(addr_mask & b) || (diff_pivots & b)) continue;
+    uint64_t vec = b;
+    for (const auto &[d, p] : diff_basis) {
+      if (d & b) vec |= p;
+    }
+    complement.push_back(vec);
+  }
+  if (complement.size() < num_bank_bits || complement.size() > 8) {
+    Logger::log_error(format_string("Recovered %zu bank/rank functions, expected between %zu and 8.",
+        complement.size(), num_bank_bits));
+    return false;
+  }
+
+  // the functions used by the memory controller are usually the ones with the fewest bits: enumerate the whole
+  // (small) space and greedily pick linearly independent vectors by increasing weight
+  std::vector<uint64_t> candidates;
+  for (uint64_t sel = 1; sel < (1UL << complement.size()); ++sel) {
+    uint64_t vec = 0;
+    for (size_t i = 0; i < complement.size(); ++i) {
+      if (sel & (1UL << i)) vec ^= complement[i];
+    }
+    candidates.push_back(vec);
+  }
+  std::sort(candidates.begin(), candidates.end(), [](uint64_t a, uint64_t b) {
+    const int wa = __builtin_popcountl(a), wb = __builtin_popcountl(b);
+    return (wa!=wb) ? (wa < wb) : (a < b);
+  });
+  std::vector<std::pair<uint64_t, uint64_t>> fn_basis;  // (reduced function, pivot bit)
+  std::vector<uint64_t> functions;
+  for (const auto &cand : candidates) {
+    uint64_t reduced = cand;
+    for (const auto &[f, p] : fn_basis) {
+      if (reduced & p) reduced ^= f;
+    }
+    if (reduced==0) continue;
+    const uint64_t pivot = reduced & -reduced;
+    for (auto &[f, p] : fn_basis) {
+      if (f & pivot) f ^= reduced;
+    }
+    fn_basis.emplace_back(reduced, pivot);
+    functions.push_back(cand);
+    if (functions.size()==complement.size()) break;
+  }
+  std::sort(functions.begin(), functions.end());
+
+  // the functions must assign a distinct bank to each conflict set
+  auto bank_of = [&functions, this](volatile char *addr) {
+    uint64_t bank = 0;
+    for (size_t i = 0; i < functions.size(); ++i) {
+      bank |= (uint64_t) __builtin_parityl((uint64_t) (addr - start_address) & functions[i]) << i;
+    }
+    return bank;
+  };
+  std::unordered_set<uint64_t> bank_ids;
+  for (const auto &bank : banks) {
+    if (bank.empty()) continue;
+    const auto id = bank_of(bank[0]);
+    for (const auto &addr : bank) {
+      if (bank_of(addr)!=id) num_rejected++;
+    }
+    if (!bank_ids.insert(id).second) {
+      Logger::log_error("Recovered bank/rank functions map two conflict sets to the same bank.");
+      return false;
+    }
+  }
+
+  // a bit is a row bit if flipping it (while compensating via the pivots to stay in the same bank) causes a row
+  // buffer conflict; we only consider the first bank's addresses and take the majority vote
+  uint64_t fn_pivots = 0;
+  for (const auto &[f, p] : fn_basis) fn_pivots |= p;
+  uint64_t recovered_row_function = 0;
+  for (size_t bit = 0; bit < MTX_SIZE; ++bit) {
+    const uint64_t b = 1UL << bit;
+    if (!(addr_mask & b) || (fn_pivots & b)) continue;
+    uint64_t flip = b;
+    for (const auto &[f, p] : fn_basis) {
+      if (f & b) flip ^= p;
+    }
+    size_t num_conflicts = 0;
+    size_t num_probes = 0;
+    for (size_t i = 0; i < banks.at(0).size() && num_probes < 5; ++i, ++num_probes) {
+      auto a1 = banks.at(0).at(i);
+      auto a2 = start_address + ((uint64_t) (a1 - start_address) ^ flip);
+      num_conflicts += (measure_time(a1, a2) > threshold);
+    }
+    if (2*num_conflicts > num_probes) recovered_row_function |= b;
+  }
+
+  // the row bits are the most significant bits, anything else points to noisy measurements
+  const uint64_t row_bits = (recovered_row_function==0)
+                            ? 0 : (recovered_row_function >> __builtin_ctzl(recovered_row_function));
+  if (row_bits==0 || (row_bits & (row_bits + 1))!=0) {
+    Logger::log_error(format_string("Recovered row bits 0x%" PRIx64 " are not contiguous.", recovered_row_function));
+    return false;
+  }
+
+  bank_rank_functions = functions;
+  row_function = recovered_row_function;
+
+  Logger::log_info("Recovered bank/rank and row function:");
+  if (num_rejected > 0) {
+    Logger::log_data(format_string("Ignored %zu address(es) that are inconsistent with the other conflicts.",
+        num_rejected));
+  }
+  Logger::log_data(format_string("Row function 0x%" PRIx64, row_function));
+  std::stringstream ss;
+  ss << "Bank/rank functions (" << bank_rank_functions.size() << "): ";
+  for (auto bank_rank_function : bank_rank_functions) {
+    ss << "0x" << std::hex << bank_rank_function << " ";
+  }
+  Logger::log_data(ss.str());
+  return true;
+}
+
+uint64_t DramAnalyzer::calibrate_ref_threshold() {
+  volatile char *a = banks.at(0).at(0);
+  volatile char *b = banks.at(0).at(1);
+
+  std::vector<uint64_t> samples(REF_CALIBRATION_SAMPLES);
+  const auto start_ts = get_timestamp_us();
+  for (auto &sample : samples) {
+    clflushopt(a);
+    clflushopt(b);
+    mfence();
+    const uint64_t before = rdtscp();
+    lfence();
+    (void)*a;
+    (void)*b;
+    sample = rdtscp() - before;
+  }
+  const auto elapsed_ns = static_cast<double>(get_timestamp_us() - start_ts)*1000.0;
+  std::sort(samples.begin(), samples.end());
+
+  // one REFRESH is issued per tREFI, hence we know how many samples were delayed by a REFRESH
+  const size_t num_samples = samples.size();
+  const size_t num_refs = std::min(num_samples/4, static_cast<size_t>(elapsed_ns/TREFI_NS));
+  const uint64_t median = samples[num_samples/2];
+
+  uint64_t fitted_threshold = 0;
+  if (num_refs > 1) {
+    // the boundary between both modes lies between the 2*num_refs slowest samples (lo) and the num_refs/2 slowest
+    // samples (hi), which must have been delayed by a REFRESH
+    const uint64_t lo = samples[num_samples - 2*num_refs];
+    const uint64_t hi = samples[num_samples - num_refs/2];
+    const size_t num_bins = static_cast<size_t>((hi - lo)/THRESH_CALIBRATION_BIN_WIDTH) + 1;
+    std::vector<size_t> histogram(num_bins, 0);
+    for (auto it = samples.end() - static_cast<int64_t>(2*num_refs); it!=samples.end() && *it <= hi; ++it) {
+      histogram[static_cast<size_t>((*it - lo)/THRESH_CALIBRATION_BIN_WIDTH)]++;
+    }
+
+    // place the threshold into the center of the longest range of bins with the fewest samples
+    const size_t min_count = *std::min_element(histogram.begin(), histogram.end());
+    size_t best_start = 0;
+    size_t best_length = 0;
+    for (size_t i = 0; i < num_bins;) {
+      size_t j = i;
+      while (j < num_bins && histogram[j]==min_count) ++j;
+      if (j - i > best_length) {
+        best_start = i;
+        best_length = j - i;
+      }
+      i = std::max(i + 1, j);
+    }
+    fitted_threshold = lo + (best_start + best_length/2)*THRESH_CALIBRATION_BIN_WIDTH;
+
+    std::stringstream ss;
+    for (size_t i = 0; i < num_bins; ++i) {
+      if (histogram[i]==0) continue;
+      ss << std::setw(5) << std::right << (lo + i*THRESH_CALIBRATION_BIN_WIDTH) << " "
+         << std::setw(5) << histogram[i] << " "
+         << std::string(std::max<size_t>(1, (histogram[i]*60)/(2*num_refs)), '#')
+         << ((i==best_start + best_length/2) ? "  <- threshold" : "") << "\n";
+    }
+    Logger::log_info("Access time histogram of the slowest same-bank accesses (cycles, count):");
+    Logger::log_data(ss.str());
+  }
+
+  // the threshold is only plausible if it detects about one REFRESH per tREFI
+  const auto num_detected = static_cast<size_t>(samples.end()
+      - std::upper_bound(samples.begin(), samples.end(), fitted_threshold));
+  const double ref_ratio = (num_refs > 0) ? static_cast<double>(num_detected)/static_cast<double>(num_refs) : 0;
+  if (fitted_threshold <= median || ref_ratio < 0.5 || ref_ratio > 2.0) {
+    Logger::log_error(format_string("Could not fit REFRESH latency distribution (detected/expected REFs: %.2f), "
+                                    "falling back to the default REFRESH threshold of %d cycles.",
+        ref_ratio, DEFAULT_REF_THRESH));
+    ref_threshold = DEFAULT_REF_THRESH;
+  } else {
+    Logger::log_info(format_string("Calibrated REFRESH threshold: %lu cycles (median access time: %lu cycles, "
+                                   "detected/expected REFs: %.2f).", fitted_threshold, median, ref_ratio));
+    ref_threshold = fitted_threshold;
+  }
+  RefTiming::set_threshold(ref_threshold);
+  return ref_threshold;
+}
+
+uint64_t DramAnalyzer::get_ref_threshold() const {
+  return ref_threshold;
+}
+
 size_t DramAnalyzer::count_acts_per_trefi() {
   size_t skip_first_N = 50;
   // pick two random same-bank addresses
@@ -155,7 +496,7 @@ size_t DramAnalyzer::count_acts_per_trefi() {
     after = rdtscp();
 
     count++;
-    if ((after - before) > 1000) {
+    if (RefTiming::is_refresh(after - before)) {
       if (i > skip_first_N && count_old!=0) {
         // multiply by 2 to account for both accesses we do (a, b)
         uint64_t value = (count - count_old)*2;
@@ -169,8 +510,236 @@ size_t DramAnalyzer::count_acts_per_trefi() {
   }
 
   auto activations = (running_sum/acts.size());
+  acts_per_trefi = activations;
   Logger::log_info("Determined the number of possible ACTs per refresh interval.");
   Logger::log_data(format_string("num_acts_per_tREFI: %lu", activations));
 
   return activations;
 }
+
+int DramAnalyzer::calibrate_threshold() {
+  std::vector<int> samples;
+  samples.reserve(THRESH_CALIBRATION_SAMPLES);
+  for (size_t i = 0; i < THRESH_CALIBRATION_SAMPLES; ++i) {
+    auto a1 = start_address + (dist(gen)%(MEM_SIZE/64))*64;
+    auto a2 = start_address + (dist(gen)%(MEM_SIZE/64))*64;
+    samples.push_back(measure_time(a1, a2));
+  }
+
+  // ignore the slowest 0.5% of the measurements, these are usually caused by interrupts and would otherwise stretch
+  // the histogram
+  std::sort(samples.begin(), samples.end());
+  samples.resize(samples.size() - samples.size()/200);
+  const int min_time = samples.front();
+  const size_t num_bins = static_cast<size_t>((samples.back() - min_time)/THRESH_CALIBRATION_BIN_WIDTH) + 1;
+  std::vector<size_t> histogram(num_bins, 0);
+  for (const auto &s : samples) histogram[static_cast<size_t>((s - min_time)/THRESH_CALIBRATION_BIN_WIDTH)]++;
+
+  // fit the two modes (row buffer hits and row buffer conflicts) using Otsu's method, i.e., choose the split that
+  // maximizes the variance between both classes
+  double total_sum = 0;
+  for (size_t i = 0; i < num_bins; ++i) total_sum += static_cast<double>(i*histogram[i]);
+  const auto total_weight = static_cast<double>(samples.size());
+  double weight_lo = 0, sum_lo = 0, best_variance = 0;
+  size_t best_split = 0;
+  for (size_t i = 0; i + 1 < num_bins; ++i) {
+    weight_lo += static_cast<double>(histogram[i]);
+    sum_lo += static_cast<double>(i*histogram[i]);
+    const double weight_hi = total_weight - weight_lo;
+    if (weight_lo==0 || weight_hi==0) continue;
+    const double mean_diff = sum_lo/weight_lo - (total_sum - sum_lo)/weight_hi;
+    const double variance = weight_lo*weight_hi*mean_diff*mean_diff;
+    if (variance > best_variance) {
+      best_variance = variance;
+      best_split = i;
+    }
+  }
+
+  // given 16 banks, about 1/16 of all random pairs conflict; we reject fits that are far off from this
+  size_t num_conflicts = 0;
+  for (size_t i = best_split + 1; i < num_bins; ++i) num_conflicts += histogram[i];
+  const double conflict_ratio = static_cast<double>(num_conflicts)/total_weight;
+  const int fitted_threshold = min_time + static_cast<int>((best_split + 1)*THRESH_CALIBRATION_BIN_WIDTH);
+
+  std::stringstream ss;
+  for (size_t i = 0; i < num_bins; ++i) {
+    if (histogram[i]==0) continue;
+    ss << std::setw(5) << std::right << (min_time + static_cast<int>(i*THRESH_CALIBRATION_BIN_WIDTH)) << " "
+       << std::setw(5) << histogram[i] << " "
+       << std::string(std::max<size_t>(1, (histogram[i]*60)/samples.size()), '#')
+       << ((i==best_split) ? "  <- threshold" : "") << "\n";
+  }
+  Logger::log_info("Access time histogram of random address pairs (cycles, count):");
+  Logger::log_data(ss.str());
+
+  if (best_variance==0 || conflict_ratio < 0.005 || conflict_ratio > 0.5) {
+    Logger::log_error(format_string("Could not fit access time distribution (conflict ratio: %.3f), "
+                                    "falling back to the default threshold of %d cycles.",
+        conflict_ratio, DEFAULT_THRESH));
+    threshold = DEFAULT_THRESH;
+  } else {
+    Logger::log_info(format_string("Calibrated row buffer conflict threshold: %d cycles (conflict ratio: %.3f).",
+        fitted_threshold, conflict_ratio));
+    threshold = fitted_threshold;
+  }
+  return threshold;
+}
+
+int DramAnalyzer::get_threshold() const {
+  return threshold;
+}
+
+size_t DramAnalyzer::get_acts_per_trefi() const {
+  return acts_per_trefi;
+}
+
+std::pair<volatile char *, volatile char *> DramAnalyzer::get_same_bank_addresses() const {
+  return {banks.at(0).at(0), banks.at(0).at(1)};
+}
+
+bool DramAnalyzer::validate_bank_conflicts() {
+  // number of address pairs probed per bank, of which the majority must behave as expected
+  const size_t NUM_PAIRS = 3;
+  // both measurements of a pair must agree so that a single noisy measurement cannot validate a stale cache
+  auto is_conflict = [this](volatile char *a1, volatile char *a2) {
+    return (measure_time(a1, a2) > threshold) && (measure_time(a1, a2) > threshold);
+  };
+  auto is_no_conflict = [this](volatile char *a1, volatile char *a2) {
+    return (measure_time(a1, a2) <= threshold) && (measure_time(a1, a2) <= threshold);
+  };
+  for (size_t i = 0; i < banks.size(); ++i) {
+    const auto &bank = banks.at(i);
+    const auto &next_bank = banks.at((i + 1)%banks.size());
+    // pair the bank's addresses from both ends so that no address is paired with itself
+    const size_t num_pairs = std::min(NUM_PAIRS, std::min(bank.size()/2, next_bank.size()));
+    if (num_pairs == 0) return false;
+    size_t num_valid_pairs = 0;
+    for (size_t j = 0; j < num_pairs; ++j) {
+      if (is_conflict(bank.at(j), bank.at(bank.size() - 1 - j)) && is_no_conflict(bank.at(j), next_bank.at(j)))
+        num_valid_pairs++;
+    }
+    if (2*num_valid_pairs <= num_pairs) return false;
+  }
+  return true;
+}
+
+bool DramAnalyzer::load_calibration(const std::string &filename, const std::string &key) {
+#ifdef ENABLE_JSON
+  std::ifstream cache_file(filename);
+  if (!cache_file.is_open()) {
+    Logger::log_info(format_string("No DRAM calibration cache found at %s.", filename.c_str()));
+    return false;
+  }
+
+  nlohmann::json root;
+  try {
+    cache_file >> root;
+  } catch (const nlohmann::json::exception &e) {
+    Logger::log_error(format_string("Could not parse DRAM calibration cache %s: %s", filename.c_str(), e.what()));
+    return false;
+  }
+  if (!root.contains(key)) {
+    Logger::log_info("DRAM calibration cache does not contain an entry for this machine and DIMM.");
+    return false;
+  }
+
+  // decode the whole entry before using any of it; a malformed entry (e.g., of the wrong type) must not crash the run
+  std::vector<std::vector<volatile char *>> cached_banks;
+  int cached_threshold;
+  size_t cached_acts_per_trefi;
+  uint64_t cached_ref_threshold;
+  try {
+    const auto &entry = root.at(key);
+    cached_threshold = entry.value("threshold", 0);
+    if (cached_threshold <= 0 || entry.at("banks").size()!=NUM_BANKS) {
+      Logger::log_info("DRAM calibration cache entry was recorded with a different configuration, ignoring it.");
+      return false;
+    }
+
+    // the cache stores the addresses as offsets into the memory area
+    for (const auto &bank : entry.at("banks")) {
+      std::vector<volatile char *> addrs;
+      for (const auto &offset : bank) {
+        const auto off = offset.get<uint64_t>();
+        if (off >= MEM_SIZE) {
+          Logger::log_info(format_string("DRAM calibration cache entry contains the offset 0x%" PRIx64 " that lies "
+                                         "beyond the first superpage, ignoring it.", off));
+          return false;
+        }
+        addrs.push_back(start_address + off);
+      }
+      cached_banks.push_back(addrs);
+    }
+    cached_acts_per_trefi = entry.value("acts_per_trefi", (size_t) 0);
+    cached_ref_threshold = entry.value("ref_threshold", (uint64_t) 0);
+  } catch (const nlohmann::json::exception &e) {
+    Logger::log_error(format_string("Could not decode DRAM calibration cache entry in %s: %s", filename.c_str(),
+        e.what()));
+    return false;
+  }
+
+  auto previous_banks = banks;
+  auto previous_threshold = threshold;
+  banks = cached_banks;
+  threshold = cached_threshold;
+  if (!validate_bank_conflicts()) {
+    Logger::log_info("Cached bank conflicts could not be confirmed, redoing the DRAM calibration.");
+    banks = previous_banks;
+    threshold = previous_threshold;
+    return false;
+  }
+  acts_per_trefi = cached_acts_per_trefi;
+  ref_threshold = cached_ref_threshold;
+  if (ref_threshold > 0) RefTiming::set_threshold(ref_threshold);
+
+  Logger::log_info(format_string("Loaded bank conflicts and threshold (%d cycles) from the DRAM calibration cache.",
+      threshold));
+  if (acts_per_trefi > 0) Logger::log_data(format_string("num_acts_per_tREFI: %lu", acts_per_trefi));
+  if (ref_threshold > 0) Logger::log_data(format_string("REFRESH threshold: %lu cycles", ref_threshold));
+  return true;
+#else
+  Logger::log_info(format_string("Cannot load DRAM calibration cache %s as JSON support is disabled.",
+      filename.c_str()));
+  (void) key;
+  return false;
+#endif
+}
+
+void DramAnalyzer::store_calibration(const std::string &filename, const std::string &key) {
+#ifdef ENABLE_JSON
+  // keep the entries of other machines/DIMMs
+  nlohmann::json root = nlohmann::json::object();
+  std::ifstream cache_file_in(filename);
+  if (cache_file_in.is_open()) {
+    try {
+      cache_file_in >> root;
+    } catch (const nlohmann::json::exception &) {
+      root = nlohmann::json::object();
+    }
+    cache_file_in.close();
+  }
+
+  nlohmann::json banks_json = nlohmann::json::array();
+  for (const auto &bank : banks) {
+    std::vector<uint64_t> offsets;
+    for (const auto &addr : bank) offsets.push_back((uint64_t) (addr - start_address));
+    banks_json.push_back(offsets);
+  }
+
+  root[key] = nlohmann::json{{"threshold", threshold},
+                             {"acts_per_trefi", acts_per_trefi},
+                             {"ref_threshold", ref_threshold},
+                             {"banks", banks_json},
+                             {"timestamp", get_timestamp_sec()}};
+
+  std::ofstream cache_file_out(filename);
+  if (!cache_file_out.is_open()) {
+    Logger::log_error(format_string("Could not write DRAM calibration cache %s.", filename.c_str()));
+    return;
+  }
+  cache_file_out << root.dump(2) << std::endl;
+#else
+  (void) filename;
+  (void) key;
+#endif
+}
@@ -1,10 +1,19 @@
 #include "Memory/Memory.hpp"
 
 #include <sys/mman.h>
+#include <sched.h>
+#include <pthread.h>
+#include <algorithm>
+#include <fstream>
+#include <thread>
 
-/// Allocates a MEM_SIZE bytes of memory by using super or huge pages.
+#include "Memory/PhysicalAddressResolver.hpp"
+#include "Utilities/TimeHelper.hpp"
+
+/// Allocates mem_size bytes of memory (rounded up to a multiple of MEM_SIZE) by using super or huge pages.
 void Memory::allocate_memory(size_t mem_size) {
-  this->size = mem_size;
+  size_t num_superpages = std::max<size_t>(1, (mem_size + MEM_SIZE - 1)/MEM_SIZE);
+  this->size = num_superpages*MEM_SIZE;
   volatile char *target = nullptr;
   FILE *fp;
 
@@ -16,21 +25,50 @@ void Memory::allocate_memory(size_t mem_size) {
       Logger::log_data(std::strerror(errno));
       exit(EXIT_FAILURE);
     }
-    auto mapped_target = mmap((void *) start_address, MEM_SIZE, PROT_READ | PROT_WRITE,
-        MAP_SHARED | MAP_ANONYMOUS | MAP_HUGETLB | (30UL << MAP_HUGE_SHIFT), fileno(fp), 0);
-    if (mapped_target==MAP_FAILED) {
-      perror("mmap");
-      exit(EXIT_FAILURE);
+    // map each superpage on its own, directly after the previous one, so that DRAMAddr can locate a superpage by its
+    // offset from the start of the memory area
+    for (size_t i = 0; i < num_superpages; ++i) {
+      auto superpage_target = (volatile char *) ((i==0) ? start_address : target + i*MEM_SIZE);
+      auto mapped_target = mmap((void *) superpage_target, MEM_SIZE, PROT_READ | PROT_WRITE,
+          MAP_SHARED | MAP_ANONYMOUS | MAP_HUGETLB | (30UL << MAP_HUGE_SHIFT), fileno(fp), 0);
+      if (mapped_target==MAP_FAILED) {
+        if (i==0) {
+          perror("mmap");
+          exit(EXIT_FAILURE);
+        }
+        Logger::log_error(format_string("Could not allocate superpage %zu, continuing with %zu superpages.", i, i));
+        Logger::log_data(std::strerror(errno));
+        num_superpages = i;
+        break;
+      } else if (i==0) {
+        target = (volatile char *) mapped_target;
+      } else if (mapped_target!=(void *) superpage_target) {
+        Logger::log_error(format_string("Could not map superpage %zu at address %p, continuing with %zu superpages.",
+            i, superpage_target, i));
+        munmap(mapped_target, MEM_SIZE);
+        num_superpages = i;
+        break;
+      }
     }
-    target = (volatile char*) mapped_target;
+    this->size = num_superpages*MEM_SIZE;
   } else {
     // allocate memory using huge pages
-    assert(posix_memalign((void **) &target, MEM_SIZE, MEM_SIZE)==0);
-    assert(madvise((void *) target, MEM_SIZE, MADV_HUGEPAGE)==0);
-    memset((char *) target, 'A', MEM_SIZE);
-    // for khugepaged
+    assert(posix_memalign((void **) &target, MEM_SIZE, size)==0);
+    assert(madvise((void *) target, size, MADV_HUGEPAGE)==0);
+    memset((char *) target, 'A', size);
+    // the pages are usually backed by huge pages at fault time already, otherwise we need to wait for khugepaged
     Logger::log_info("Waiting for khugepaged.");
-    sleep(10);
+    const auto start_ts = get_timestamp_us();
+    size_t huge_page_bytes = PhysicalAddressResolver::get_huge_page_backed_bytes(target, size);
+    while (huge_page_bytes < size && (get_timestamp_us() - start_ts) < HUGEPAGE_WAIT_TIMEOUT_US) {
+      usleep(100000);
+      huge_page_bytes = PhysicalAddressResolver::get_huge_page_backed_bytes(target, size);
+    }
+    Logger::log_info(format_string("%lu of %lu MB are backed by huge pages after %.2f s.",
+        huge_page_bytes/MB(1), size/MB(1), static_cast<double>(get_timestamp_us() - start_ts)/1e6));
+    if (huge_page_bytes < size) {
+      Logger::log_error("Memory area is not fully backed by huge pages, the DRAM address functions may be inaccurate.");
+    }
   }
 
   if (target!=start_address) {
@@ -38,56 +76,185 @@ void Memory::allocate_memory(size_t mem_size) {
         start_address, target));
     start_address = target;
   }
+  Logger::log_info(format_string("Allocated %zu superpage(s) of %lu MB each.", get_num_superpages(), MEM_SIZE/MB(1)));
+
+  // the DRAM address functions are applied to the virtual addresses, this is only correct if these agree with the
+  // physical addresses in all bits covered by the functions; as all bit flips found otherwise would be attributed to
+  // wrong DRAM locations, we refuse to run on such a memory area (e.g., if it is backed by 2 MB transparent huge pages)
+  PhysicalAddressResolver phys_resolver;
+  if (phys_resolver.build_index(start_address, size)) {
+    const auto num_misaligned_pages = phys_resolver.count_misaligned_pages(MEM_SIZE);
+    if (num_misaligned_pages > 0) {
+      Logger::log_error(format_string("%zu pages have a physical address that does not match their virtual address "
+                                      "modulo %lu MB, the DRAM address functions cannot be applied to them.",
+          num_misaligned_pages, MEM_SIZE/MB(1)));
+      Logger::log_error("Aborting. Please provide 1 GB pages via a hugetlbfs mount.");
+      exit(EXIT_FAILURE);
+    } else {
+      Logger::log_info(format_string("Verified that the memory area is physically aligned to %lu MB.",
+          MEM_SIZE/MB(1)));
+    }
+  } else {
+    Logger::log_info("Could not read physical addresses, assuming the memory area is physically aligned.");
+  }
 
   // initialize memory with random but reproducible sequence of numbers
+  DataPatternKernel::initialize();
   initialize(DATA_PATTERN::RANDOM);
 }
 
 void Memory::initialize(DATA_PATTERN data_pattern) {
   Logger::log_info("Initializing memory with pseudorandom sequence.");
 
-  // for each page in the address space [start, end]
-  for (uint64_t cur_page = 0; cur_page < size; cur_page += getpagesize()) {
-    // reseed rand to have a sequence of reproducible numbers, using this we can compare the initialized values with
-    // those after hammering to see whether bit flips occurred
-    srand(static_cast<unsigned int>(cur_page*getpagesize()));
-    for (uint64_t cur_pageoffset = 0; cur_pageoffset < (uint64_t) getpagesize(); cur_pageoffset += sizeof(int)) {
-
-      int fill_value = 0;
-      if (data_pattern == DATA_PATTERN::RANDOM) {
-        fill_value = rand();
-      } else if (data_pattern == DATA_PATTERN::ZEROES) {
-        fill_value = 0;
-      } else if (data_pattern == DATA_PATTERN::ONES) {
-        fill_value = 1;
-      } else {
-        Logger::log_error("Could not initialize memory with given (unknown) DATA_PATTERN.");
+  // the data pattern is generated by a counter-based PRNG keyed by the offset, using this we can compare the
+  // initialized values with those after hammering to see whether bit flips occurred; as each page is seeded on its
+  // own, the result does not depend on the number of threads nor on the order in which the pages are written
+  DataPatternKernel::set_data_pattern(data_pattern);
+
+  // pin the workers to the CPUs of the NUMA node we are running on, i.e., the node on which we later hammer
+  const auto cpus = get_numa_local_cpus();
+  const size_t num_threads = std::max<size_t>(1, (num_init_threads==0) ? cpus.size() : num_init_threads);
+
+  // split the memory area into equally-sized chunks of pages
+  const auto pagesize = static_cast<uint64_t>(getpagesize());
+  const uint64_t num_pages = size/pagesize;
+  const uint64_t pages_per_thread = (num_pages + num_threads - 1)/num_threads;
+
+  const auto start_ts = get_timestamp_us();
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < num_threads; ++t) {
+    const uint64_t chunk_start = std::min(num_pages, t*pages_per_thread)*pagesize;
+    const uint64_t chunk_end = std::min(num_pages, (t + 1)*pages_per_thread)*pagesize;
+    const int cpu = cpus.empty() ? -1 : cpus.at(t%cpus.size());
+    workers.emplace_back([this, chunk_start, chunk_end, pagesize, cpu]() {
+      // pin the worker before it writes any page such that the whole chunk is filled from the local NUMA node
+      if (cpu >= 0) pin_current_thread(cpu);
+      // use non-temporal stores to not evict the data from the LLC that we rely on for timing measurements
+      for (uint64_t cur_page = chunk_start; cur_page < chunk_end; cur_page += pagesize) {
+        DataPatternKernel::fill_non_temporal(start_address + cur_page, cur_page, pagesize);
       }
-        
-      // write (pseudo)random 4 bytes
-      uint64_t offset = cur_page + cur_pageoffset;
-      *((int *) (start_address + offset)) = fill_value;
+      sfence();
+    });
+  }
+  for (auto &w : workers) w.join();
+  const auto elapsed_us = std::max<int64_t>(1, get_timestamp_us() - start_ts);
+
+  Logger::log_info(format_string("Initialized %lu MB of memory using %zu threads in %.2f ms (%.2f GB/s).",
+      size/MB(1),
+      num_threads,
+      static_cast<double>(elapsed_us)/1000.0,
+      (static_cast<double>(size)/static_cast<double>(GB(1)))/(static_cast<double>(elapsed_us)/1e6)));
+}
+
+void Memory::set_num_init_threads(size_t num_threads) {
+  num_init_threads = num_threads;
+}
+
+bool Memory::pin_current_thread(int cpu) {
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu, &cpuset);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset)==0;
+}
+
+std::vector<int> Memory::get_numa_local_cpus() {
+  // determine the NUMA node of the CPU we are currently running on
+  std::vector<int> cpus;
+  const int cur_cpu = sched_getcpu();
+  std::string cpulist;
+  for (int node = 0; cur_cpu >= 0; ++node) {
+    std::ifstream node_cpulist(format_string("/sys/devices/system/node/node%d/cpulist", node));
+    if (!node_cpulist.is_open()) break;
+    std::string line;
+    std::getline(node_cpulist, line);
+    // the cpulist has the format "0-3,8-11"
+    std::vector<int> node_cpus;
+    std::stringstream ss(line);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+      auto sep = range.find('-');
+      int lo = std::stoi(range.substr(0, sep));
+      int hi = (sep==std::string::npos) ? lo : std::stoi(range.substr(sep + 1));
+      for (int c = lo; c <= hi; ++c) node_cpus.push_back(c);
+    }
+    if (std::find(node_cpus.begin(), node_cpus.end(), cur_cpu)!=node_cpus.end()) {
+      cpus = node_cpus;
+      break;
     }
   }
+
+  // only keep the CPUs that we are allowed to run on
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed)!=0) return {};
+  if (cpus.empty()) {
+    // no NUMA information available (e.g., sysfs is not mounted): use all CPUs
+    for (int c = 0; c < CPU_SETSIZE; ++c) cpus.push_back(c);
+  }
+  cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&allowed](int c) {
+    return c >= CPU_SETSIZE || !CPU_ISSET(c, &allowed);
+  }), cpus.end());
+  return cpus;
+}
+
+size_t Memory::benchmark_check_memory() {
+  // we only use the kernel here (and not check_memory) as the DRAMAddr functions required to report bit flips may not
+  // have been initialized yet
+  const auto pagesize = static_cast<uint64_t>(getpagesize());
+  size_t num_corrupted_pages = 0;
+  const auto start_ts = get_timestamp_us();
+  for (uint64_t cur_page = 0; cur_page < size; cur_page += pagesize) {
+    num_corrupted_pages += (DataPatternKernel::find_mismatch(start_address + cur_page, cur_page, pagesize)!=pagesize);
+  }
+  const auto elapsed_us = std::max<int64_t>(1, get_timestamp_us() - start_ts);
+
+  Logger::log_info(format_string("Verified %lu MB of memory using the %s kernel in %.2f ms (%.2f GB/s).",
+      size/MB(1),
+      DataPatternKernel::get_impl_name().c_str(),
+      static_cast<double>(elapsed_us)/1000.0,
+      (static_cast<double>(size)/static_cast<double>(GB(1)))/(static_cast<double>(elapsed_us)/1e6)));
+  if (num_corrupted_pages > 0) {
+    Logger::log_error(format_string("Found %lu pages that do not match the data pattern right after initialization.",
+        num_corrupted_pages));
+  }
+  return num_corrupted_pages;
 }
 
 size_t Memory::check_memory(PatternAddressMapper &mapping, bool reproducibility_mode, bool verbose) {
+  std::lock_guard<std::mutex> lock(check_mutex);
   flipped_bits.clear();
 
   auto victim_rows = mapping.get_victim_rows();
   if (verbose) Logger::log_info(format_string("Checking %zu victims for bit flips.", victim_rows.size()));
 
+  // the virtual addresses between a row's first byte and the next row's first byte span many rows of other banks, we
+  // therefore only check the cache lines that actually belong to the victim's (bank, row); this requires that the lower
+  // column bits map 1:1 to the cache line offset, which holds for all configs defined in DRAMAddr::initialize_configs
+  const auto num_columns = DRAMAddr::get_num_columns();
+  std::vector<DRAMAddr> row_lines;
+  std::vector<volatile char *> row_line_addrs;
   size_t sum_found_bitflips = 0;
   for (const auto &victim_row : victim_rows) {
-    auto victim_dram_addr = DRAMAddr((char*)victim_row);
-    victim_dram_addr.add_inplace(0, 1, 0);
-    sum_found_bitflips += check_memory_internal(mapping, victim_row,
-        (volatile char *) victim_dram_addr.to_virt(), reproducibility_mode, verbose);
+    const auto victim_dram_addr = DRAMAddr((char *) victim_row);
+    row_lines.clear();
+    for (size_t col = 0; col < num_columns; col += CACHELINE_SIZE) {
+      row_lines.emplace_back(victim_dram_addr.bank, victim_dram_addr.row, col);
+    }
+    row_line_addrs.clear();
+    DRAMAddr::to_virt(row_lines, row_line_addrs);
+
+    for (const auto &line_addr : row_line_addrs) {
+      const auto line_offset = (uint64_t) (line_addr - start_address);
+      // if this address is outside the superpage we must not proceed to avoid segfault
+      if (line_offset >= size) continue;
+      sum_found_bitflips += check_range_internal(mapping, line_offset, CACHELINE_SIZE, reproducibility_mode, verbose);
+    }
   }
   return sum_found_bitflips;
 }
 
 size_t Memory::check_memory(const volatile char *start, const volatile char *end) {
+  std::lock_guard<std::mutex> lock(check_mutex);
   flipped_bits.clear();
   // create a "fake" pattern mapping to keep this method for backward compatibility
   PatternAddressMapper pattern_mapping;
@@ -117,87 +284,80 @@ size_t Memory::check_memory_internal(PatternAddressMapper &mapping,
   auto end_offset = start_offset + (uint64_t) (end - start);
   end_offset = (end_offset/pagesize)*pagesize;
 
-  void *page_raw = malloc(pagesize);
-  if (page_raw == nullptr) {
-    Logger::log_error("Could not create temporary page for memory comparison.");
-    exit(EXIT_FAILURE);
-  }
-  memset(page_raw, 0, pagesize);
-  int *page = (int*)page_raw;
+  // if this address is outside the superpage we must not proceed to avoid segfault
+  end_offset = std::min(end_offset, size);
 
   // for each page (4K) in the address space [start, end]
   for (uint64_t i = start_offset; i < end_offset; i += pagesize) {
-    // reseed rand to have the desired sequence of reproducible numbers
-    srand(static_cast<unsigned int>(i*pagesize));
+    found_bitflips += check_range_internal(mapping, i, pagesize, reproducibility_mode, verbose);
+  }
 
-    // fill comparison page with expected values generated by rand()
-    for (size_t j = 0; j < (unsigned long) pagesize/sizeof(int); ++j)
-      page[j] = rand();
+  return found_bitflips;
+}
 
-    uint64_t addr = ((uint64_t)start_address+i);
+size_t Memory::check_range_internal(PatternAddressMapper &mapping,
+                                    uint64_t offset,
+                                    size_t len,
+                                    bool reproducibility_mode,
+                                    bool verbose) {
+  size_t found_bitflips = 0;
 
-    // check if any bit flipped in the page using the fast memcmp function, if any flip occurred we need to iterate over
-    // each byte one-by-one (much slower), otherwise we just continue with the next page
-    if ((addr+ pagesize) < ((uint64_t)start_address+size) && memcmp((void*)addr, (void*)page, pagesize) == 0)
-      continue;
+  // check if any bit flipped in the range using the vectorized kernel, if any flip occurred we need to iterate over
+  // each byte one-by-one (much slower), otherwise we are done
+  auto first_mismatch = DataPatternKernel::find_mismatch(start_address + offset, offset, len);
+  if (first_mismatch==len)
+    return found_bitflips;
 
-    // iterate over blocks of 4 bytes (=sizeof(int))
-    for (uint64_t j = 0; j < (uint64_t) pagesize; j += sizeof(int)) {
-      uint64_t offset = i + j;
-      volatile char *cur_addr = start_address + offset;
+  // iterate over blocks of 4 bytes (=sizeof(int)), starting at the first block that did not match
+  for (uint64_t j = first_mismatch; j < (uint64_t) len; j += sizeof(int)) {
+    volatile char *cur_addr = start_address + offset + j;
 
-      // if this address is outside the superpage we must not proceed to avoid segfault
-      if ((uint64_t)cur_addr >= ((uint64_t)start_address+size))
-        continue;
-
-      // clear the cache to make sure we do not access a cached value
-      clflushopt(cur_addr);
-      mfence();
-
-      // if the bit did not flip -> continue checking next block
-      int expected_rand_value = page[j/sizeof(int)];
-      if (*((int *) cur_addr)==expected_rand_value)
-        continue;
-
-      // if the bit flipped -> compare byte per byte
-      for (unsigned long c = 0; c < sizeof(int); c++) {
-        volatile char *flipped_address = cur_addr + c;
-        if (*flipped_address != ((char *) &expected_rand_value)[c]) {
-          const auto flipped_addr_dram = DRAMAddr((void *) flipped_address);
-          assert(flipped_address == (volatile char*)flipped_addr_dram.to_virt());
-          const auto flipped_addr_value = *(unsigned char *) flipped_address;
-          const auto expected_value = ((unsigned char *) &expected_rand_value)[c];
-          if (verbose) {
-            Logger::log_bitflip(flipped_address, flipped_addr_dram.row,
-                expected_value, flipped_addr_value, (size_t) time(nullptr), true);
-          }
-          // store detailed information about the bit flip
-          BitFlip bitflip(flipped_addr_dram, (expected_value ^ flipped_addr_value), flipped_addr_value);
-          // ..in the mapping that triggered this bit flip
-          if (!reproducibility_mode) {
-            if (mapping.bit_flips.empty()) {
-              Logger::log_error("Cannot store bit flips found in given address mapping.\n"
-                                "You need to create an empty vector in PatternAddressMapper::bit_flips before calling "
-                                "check_memory.");
-            }
-            mapping.bit_flips.back().push_back(bitflip);
+    // clear the cache to make sure we do not access a cached value
+    clflushopt(cur_addr);
+    mfence();
+
+    // if the bit did not flip -> continue checking next block
+    auto expected_rand_value = DataPatternKernel::expected_value(offset + j);
+    if (*((uint32_t *) cur_addr)==expected_rand_value)
+      continue;
+
+    // if the bit flipped -> compare byte per byte
+    for (unsigned long c = 0; c < sizeof(int); c++) {
+      volatile char *flipped_address = cur_addr + c;
+      if (*flipped_address != ((char *) &expected_rand_value)[c]) {
+        const auto flipped_addr_dram = DRAMAddr((void *) flipped_address);
+        assert(flipped_address == (volatile char*)flipped_addr_dram.to_virt());
+        const auto flipped_addr_value = *(unsigned char *) flipped_address;
+        const auto expected_value = ((unsigned char *) &expected_rand_value)[c];
+        if (verbose) {
+          Logger::log_bitflip(flipped_address, flipped_addr_dram.row,
+              expected_value, flipped_addr_value, (size_t) time(nullptr), true);
+        }
+        // store detailed information about the bit flip
+        BitFlip bitflip(flipped_addr_dram, (expected_value ^ flipped_addr_value), flipped_addr_value);
+        // ..in the mapping that triggered this bit flip
+        if (!reproducibility_mode) {
+          if (mapping.bit_flips.empty()) {
+            Logger::log_error("Cannot store bit flips found in given address mapping.\n"
+                              "You need to create an empty vector in PatternAddressMapper::bit_flips before calling "
+                              "check_memory.");
           }
-          // ..in an attribute of this class so that it can be retrived by the caller
-          flipped_bits.push_back(bitflip);
-          found_bitflips += bitflip.count_bit_corruptions();
+          mapping.bit_flips.back().push_back(bitflip);
         }
+        // ..in an attribute of this class so that it can be retrived by the caller
+        flipped_bits.push_back(bitflip);
+        found_bitflips += bitflip.count_bit_corruptions();
       }
+    }
 
-      // restore original (unflipped) value
-      *((int *) cur_addr) = expected_rand_value;
+    // restore original (unflipped) value
+    *((uint32_t *) cur_addr) = expected_rand_value;
 
-      // flush this address so that value is committed before hammering again there
-      clflushopt(cur_addr);
-      mfence();
-    }
+    // flush this address so that value is committed before hammering again there
+    clflushopt(cur_addr);
+    mfence();
   }
-  
-  free(page);
+
   return found_bitflips;
 }
 
@@ -215,6 +375,10 @@ volatile char *Memory::get_starting_address() const {
   return start_address;
 }
 
+size_t Memory::get_num_superpages() const {
+  return size/MEM_SIZE;
+}
+
 std::string Memory::get_flipped_rows_text_repr() {
   // first extract all rows, otherwise it will not be possible to know in advance whether we we still
   // need to add a separator (comma) to the string as upcoming DRAMAddr instances might refer to the same row
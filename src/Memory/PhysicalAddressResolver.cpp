@@ -0,0 +1,108 @@
+#include "Memory/PhysicalAddressResolver.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "GlobalDefines.hpp"
+
+// the layout of a pagemap entry, see https://www.kernel.org/doc/Documentation/vm/pagemap.txt
+#define PAGEMAP_PRESENT (1ULL << 63ULL)
+#define PAGEMAP_PFN_MASK ((1ULL << 55ULL) - 1ULL)
+
+bool PhysicalAddressResolver::build_index(volatile char *start, size_t region_size) {
+  start_address = start;
+  size = region_size;
+  pfns.clear();
+
+  int fd = open("/proc/self/pagemap", O_RDONLY);
+  if (fd < 0) {
+    Logger::log_error("Could not open /proc/self/pagemap. Error:");
+    Logger::log_data(std::strerror(errno));
+    return false;
+  }
+
+  // read the entries of all pages at once, in chunks to keep the number of syscalls low
+  const auto pagesize = static_cast<uint64_t>(getpagesize());
+  const uint64_t num_pages = size/pagesize;
+  std::vector<uint64_t> entries(num_pages);
+  const uint64_t first_entry = (uint64_t) start/pagesize;
+  const uint64_t entries_per_read = 65536;
+  for (uint64_t i = 0; i < num_pages; i += entries_per_read) {
+    const auto count = std::min(entries_per_read, num_pages - i);
+    const auto bytes = static_cast<ssize_t>(count*sizeof(uint64_t));
+    if (pread(fd, entries.data() + i, static_cast<size_t>(bytes),
+        static_cast<off_t>((first_entry + i)*sizeof(uint64_t)))!=bytes) {
+      Logger::log_error("Could not read /proc/self/pagemap. Error:");
+      Logger::log_data(std::strerror(errno));
+      close(fd);
+      return false;
+    }
+  }
+  close(fd);
+
+  // the PFN is zeroed by the kernel if we are lacking the CAP_SYS_ADMIN capability
+  pfns.reserve(num_pages);
+  for (uint64_t i = 0; i < num_pages; ++i) {
+    const uint64_t pfn = (entries[i] & PAGEMAP_PRESENT) ? (entries[i] & PAGEMAP_PFN_MASK) : 0;
+    if (pfn==0) {
+      Logger::log_error(format_string("Could not determine physical address of page %p (missing privileges?).",
+          start + i*pagesize));
+      pfns.clear();
+      return false;
+    }
+    pfns.push_back(pfn);
+  }
+  return true;
+}
+
+size_t PhysicalAddressResolver::count_misaligned_pages(size_t alignment) const {
+  const auto pagesize = static_cast<uint64_t>(getpagesize());
+  size_t num_misaligned = 0;
+  for (uint64_t i = 0; i < pfns.size(); ++i) {
+    const auto virt_addr = (uint64_t) (start_address + i*pagesize);
+    num_misaligned += ((virt_addr%alignment)!=((pfns[i]*pagesize)%alignment));
+  }
+  return num_misaligned;
+}
+
+size_t PhysicalAddressResolver::get_huge_page_backed_bytes(const volatile char *start, size_t region_size) {
+  std::ifstream smaps("/proc/self/smaps");
+  if (!smaps.is_open()) {
+    Logger::log_error("Could not open /proc/self/smaps.");
+    return 0;
+  }
+
+  const auto region_start = (uint64_t) start;
+  const auto region_end = region_start + region_size;
+  size_t huge_page_kb = 0;
+  bool in_region = false;
+  std::string line;
+  while (std::getline(smaps, line)) {
+    // a mapping's header has the format "2000000000-2040000000 rw-s 00000000 00:0f 1234 /anon_hugepage (deleted)"
+    auto sep = line.find('-');
+    auto space = line.find(' ');
+    if (sep!=std::string::npos && space!=std::string::npos && sep < space
+        && line.find_first_not_of("0123456789abcdef")==sep) {
+      const uint64_t vma_start = std::stoull(line.substr(0, sep), nullptr, 16);
+      const uint64_t vma_end = std::stoull(line.substr(sep + 1, space - sep - 1), nullptr, 16);
+      in_region = (vma_start < region_end && vma_end > region_start);
+      continue;
+    }
+    if (!in_region) continue;
+
+    // the fields have the format "AnonHugePages:    1048576 kB"
+    std::stringstream ss(line);
+    std::string field;
+    size_t value_kb = 0;
+    ss >> field >> value_kb;
+    if (field=="AnonHugePages:" || field=="Shared_Hugetlb:" || field=="Private_Hugetlb:") {
+      huge_page_kb += value_kb;
+    }
+  }
+  return huge_page_kb*1024;
+}
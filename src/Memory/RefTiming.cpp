@@ -0,0 +1,9 @@
+#include "Memory/RefTiming.hpp"
+
+#include "GlobalDefines.hpp"
+
+uint64_t RefTiming::threshold = DEFAULT_REF_THRESH;
+
+void RefTiming::set_threshold(uint64_t cycles) {
+  threshold = cycles;
+}
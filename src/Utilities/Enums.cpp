@@ -1,5 +1,6 @@
 #include "Utilities/Enums.hpp"
 
+#include <cpuid.h>
 #include <map>
 #include <Utilities/Range.hpp>
 
@@ -41,6 +42,78 @@ void from_string(const std::string &strategy, FENCING_STRATEGY &dest) {
   dest = map.at(strategy);
 }
 
+std::string to_string(ACCESS_STRATEGY strategy) {
+  std::map<ACCESS_STRATEGY, std::string> map =
+      {
+          {ACCESS_STRATEGY::LOAD, "LOAD"},
+          {ACCESS_STRATEGY::NONTEMPORAL_LOAD, "NONTEMPORAL_LOAD"},
+          {ACCESS_STRATEGY::PREFETCHNTA, "PREFETCHNTA"},
+          {ACCESS_STRATEGY::STORE, "STORE"}
+      };
+  return map.at(strategy);
+}
+
+void from_string(const std::string &strategy, ACCESS_STRATEGY &dest) {
+  std::map<std::string, ACCESS_STRATEGY> map =
+      {
+          {"LOAD", ACCESS_STRATEGY::LOAD},
+          {"NONTEMPORAL_LOAD", ACCESS_STRATEGY::NONTEMPORAL_LOAD},
+          {"PREFETCHNTA", ACCESS_STRATEGY::PREFETCHNTA},
+          {"STORE", ACCESS_STRATEGY::STORE}
+      };
+  dest = map.at(strategy);
+}
+
+std::string to_string(FLUSH_INSTRUCTION instruction) {
+  std::map<FLUSH_INSTRUCTION, std::string> map =
+      {
+          {FLUSH_INSTRUCTION::CLFLUSH, "CLFLUSH"},
+          {FLUSH_INSTRUCTION::CLFLUSHOPT, "CLFLUSHOPT"},
+          {FLUSH_INSTRUCTION::CLWB, "CLWB"}
+      };
+  return map.at(instruction);
+}
+
+void from_string(const std::string &instruction, FLUSH_INSTRUCTION &dest) {
+  std::map<std::string, FLUSH_INSTRUCTION> map =
+      {
+          {"CLFLUSH", FLUSH_INSTRUCTION::CLFLUSH},
+          {"CLFLUSHOPT", FLUSH_INSTRUCTION::CLFLUSHOPT},
+          {"CLWB", FLUSH_INSTRUCTION::CLWB}
+      };
+  dest = map.at(instruction);
+}
+
+const std::vector<ACCESS_STRATEGY> &get_supported_access_strategies() {
+  static const std::vector<ACCESS_STRATEGY> supported = [] {
+    std::vector<ACCESS_STRATEGY> strategies = {ACCESS_STRATEGY::LOAD, ACCESS_STRATEGY::PREFETCHNTA,
+                                               ACCESS_STRATEGY::STORE};
+    unsigned int eax, ebx, ecx, edx;
+    // CPUID.01H:ECX.SSE4_1[bit 19]
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1U << 19))) {
+      strategies.push_back(ACCESS_STRATEGY::NONTEMPORAL_LOAD);
+    }
+    return strategies;
+  }();
+  return supported;
+}
+
+const std::vector<FLUSH_INSTRUCTION> &get_supported_flush_instructions() {
+  static const std::vector<FLUSH_INSTRUCTION> supported = [] {
+    std::vector<FLUSH_INSTRUCTION> instructions;
+    unsigned int eax, ebx, ecx, edx;
+    // CPUID.(EAX=07H,ECX=0):EBX.CLFLUSHOPT[bit 23] and EBX.CLWB[bit 24]
+    const bool has_leaf7 = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx);
+    if (has_leaf7 && (ebx & (1U << 23))) instructions.push_back(FLUSH_INSTRUCTION::CLFLUSHOPT);
+    const bool has_clwb = has_leaf7 && (ebx & (1U << 24));
+    // clflush is supported by every x86-64 CPU
+    instructions.push_back(FLUSH_INSTRUCTION::CLFLUSH);
+    if (has_clwb) instructions.push_back(FLUSH_INSTRUCTION::CLWB);
+    return instructions;
+  }();
+  return supported;
+}
+
 [[maybe_unused]] std::pair<FLUSHING_STRATEGY, FENCING_STRATEGY> get_valid_strategy_pair() {
   auto valid_strategies = get_valid_strategies();
   auto num_strategies = valid_strategies.size();
@@ -6,8 +6,26 @@
 // initialize the singleton instance
 Logger Logger::instance; /* NOLINT */
 
+thread_local std::unique_ptr<std::ostringstream> Logger::capture_buffer = nullptr;
+
 Logger::Logger() = default;
 
+std::ostream &Logger::out() {
+  if (capture_buffer!=nullptr) return *capture_buffer;
+  return instance.logfile;
+}
+
+void Logger::begin_capture() {
+  capture_buffer = std::make_unique<std::ostringstream>();
+}
+
+std::string Logger::end_capture() {
+  if (capture_buffer==nullptr) return "";
+  auto captured = capture_buffer->str();
+  capture_buffer = nullptr;
+  return captured;
+}
+
 void Logger::initialize() {
   instance.logfile = std::ofstream();
 
@@ -24,26 +42,26 @@ void Logger::close() {
 }
 
 void Logger::log_info(const std::string &message, bool newline) {
-  instance.logfile << FC_CYAN "[+] " << message;
-  instance.logfile << F_RESET;
-  if (newline) instance.logfile << "\n";
+  out() << FC_CYAN "[+] " << message;
+  out() << F_RESET;
+  if (newline) out() << "\n";
 }
 
 void Logger::log_highlight(const std::string &message, bool newline) {
-  instance.logfile << FC_MAGENTA << FF_BOLD << "[+] " << message;
-  instance.logfile << F_RESET;
-  if (newline) instance.logfile << "\n";
+  out() << FC_MAGENTA << FF_BOLD << "[+] " << message;
+  out() << F_RESET;
+  if (newline) out() << "\n";
 }
 
 void Logger::log_error(const std::string &message, bool newline) {
-  instance.logfile << FC_RED "[-] " << message;
-  instance.logfile << F_RESET;
-  if (newline) instance.logfile << "\n";
+  out() << FC_RED "[-] " << message;
+  out() << F_RESET;
+  if (newline) out() << "\n";
 }
 
 void Logger::log_data(const std::string &message, bool newline) {
-  instance.logfile << message;
-  if (newline) instance.logfile << "\n";
+  out() << message;
+  if (newline) out() << "\n";
 }
 
 void Logger::log_analysis_stage(const std::string &message, bool newline) {
@@ -52,16 +70,16 @@ void Logger::log_analysis_stage(const std::string &message, bool newline) {
   // this makes sure that all log analysis stage messages have the same length
   auto remaining_chars = 80-message.length();
   while (remaining_chars--) ss << "█";
-  instance.logfile << ss.str();
-  instance.logfile << F_RESET;
-  if (newline) instance.logfile << "\n";
+  out() << ss.str();
+  out() << F_RESET;
+  if (newline) out() << "\n";
 }
 
 void Logger::log_debug(const std::string &message, bool newline) {
 #ifdef DEBUG
-  instance.logfile << FC_YELLOW "[DEBUG] " << message;
-  instance.logfile << F_RESET;
-  if (newline) instance.logfile << std::endl;
+  out() << FC_YELLOW "[DEBUG] " << message;
+  out() << F_RESET;
+  if (newline) out() << std::endl;
 #else
   // this is just to ignore complaints of the compiler about unused params
   std::ignore = message;
@@ -90,27 +108,27 @@ void Logger::log_timestamp() {
 
 void Logger::log_bitflip(volatile char *flipped_address, uint64_t row_no, unsigned char actual_value,
                          unsigned char expected_value, unsigned long timestamp, bool newline) {
-  instance.logfile << FC_GREEN
-                   << "[!] Flip " << std::hex << (void *) flipped_address << ", "
-                   << std::dec << "row " << row_no << ", "
-                   << "page offset: " << (uint64_t)flipped_address%(uint64_t)getpagesize() << ", "
-                   << "byte offset: " << (uint64_t)flipped_address%(uint64_t)8 << ", "
-                   << std::hex << "from " << (int) expected_value << " to " << (int) actual_value << ", "
-                   << std::dec << "detected after " << format_timestamp(timestamp - instance.timestamp_start) << ".";
-  instance.logfile << F_RESET;
-  if (newline) instance.logfile << "\n";
+  out() << FC_GREEN
+        << "[!] Flip " << std::hex << (void *) flipped_address << ", "
+        << std::dec << "row " << row_no << ", "
+        << "page offset: " << (uint64_t)flipped_address%(uint64_t)getpagesize() << ", "
+        << "byte offset: " << (uint64_t)flipped_address%(uint64_t)8 << ", "
+        << std::hex << "from " << (int) expected_value << " to " << (int) actual_value << ", "
+        << std::dec << "detected after " << format_timestamp(timestamp - instance.timestamp_start) << ".";
+  out() << F_RESET;
+  if (newline) out() << "\n";
 }
 
 void Logger::log_success(const std::string &message, bool newline) {
-  instance.logfile << FC_GREEN << "[!] " << message;
-  instance.logfile << F_RESET;
-  if (newline) instance.logfile << "\n";
+  out() << FC_GREEN << "[!] " << message;
+  out() << F_RESET;
+  if (newline) out() << "\n";
 }
 
 void Logger::log_failure(const std::string &message, bool newline) {
-  instance.logfile << FC_RED_BRIGHT << "[-] " << message;
-  instance.logfile << F_RESET;
-  if (newline) instance.logfile << "\n";
+  out() << FC_RED_BRIGHT << "[-] " << message;
+  out() << F_RESET;
+  if (newline) out() << "\n";
 }
 
 void Logger::log_metadata(const char *commit_hash, unsigned long run_time_limit_seconds) {
@@ -135,7 +153,7 @@ void Logger::log_global_defines() {
   ss << "DRAMA_ROUNDS: " << DRAMA_ROUNDS << "\n"
      << "CACHELINE_SIZE: " << CACHELINE_SIZE << "\n"
      << "HAMMER_ROUNDS: " << HAMMER_ROUNDS << "\n"
-     << "THRESH: " << THRESH << "\n"
+     << "DEFAULT_THRESH: " << DEFAULT_THRESH << "\n"
      << "NUM_TARGETS: " << NUM_TARGETS << "\n"
      << "MAX_ROWS: " << MAX_ROWS << "\n"
      << "NUM_BANKS: " << NUM_BANKS << "\n"